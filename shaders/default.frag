@@ -11,6 +11,15 @@ uniform sampler2D diffuseTextures;
 
 uniform int Frame;
 
+// Auto-exposure: average luminance computed by GpuReduction from the histogram of the image
+layout(std430, binding = 37) readonly buffer ReductionResults {
+    float reductionResults[];
+};
+uniform int AutoExposure = 0;
+uniform int ExposureSlot = 0;
+uniform float ExposureKey = 0.18;        // Luminance the average is mapped to
+uniform vec2 ExposureLimits = vec2(0.25, 8.0);
+
 vec3 LinearToInverseGamma(vec3 rgb, float gamma);
 vec3 ACESFilm(vec3 x);
 
@@ -23,7 +32,14 @@ void main() {
 
     float c = color0.a / 100.0f;
 
-    vec3 gamma = ACESFilm(color0.rgb);
+    float exposure = 1.0;
+    if (AutoExposure == 1) {
+        float averageLuminance = reductionResults[ExposureSlot];
+        if (averageLuminance > 0.0)
+            exposure = clamp(ExposureKey / averageLuminance, ExposureLimits.x, ExposureLimits.y);
+    }
+
+    vec3 gamma = ACESFilm(color0.rgb * exposure);
     gamma = LinearToInverseGamma(gamma.rgb, 2.4);
 
     vec4 tex = texture(diffuseTextures, texCoord);
@@ -0,0 +1,13 @@
+#version 430 core
+
+flat in int triangleIndex;
+
+uniform int ModelIndex;
+
+// Triangle index + 1 (0 where nothing was rasterized) and the model it belongs to
+layout(location = 0) out uvec2 visibility;
+
+void main()
+{
+    visibility = uvec2(uint(triangleIndex) + 1u, uint(ModelIndex));
+}
@@ -0,0 +1,34 @@
+#version 430 core
+
+/******************************************************************************
+  Visibility buffer of the hybrid primary hits (VisibilityBuffer.cpp). The
+  vertices are pulled from the path tracer's triangle buffer, three per
+  triangle without a vertex array, so gl_VertexID / 3 is the index
+  compute.comp uses for the same triangle.
+******************************************************************************/
+
+struct Triangle {
+    vec3 posA, posB, posC;
+    vec3 normA, normB, normC;
+    vec2 uvA, uvB, uvC, uvD;
+};
+
+// Binding 9: Triangle buffer of compute.comp
+layout(std430, binding = 9) readonly buffer TriangleData {
+    Triangle Triangles[];
+};
+
+uniform mat4 ViewProjection;
+
+flat out int triangleIndex;
+
+void main()
+{
+    int triangle = gl_VertexID / 3;
+    int corner = gl_VertexID - triangle * 3;
+    Triangle tri = Triangles[triangle];
+    vec3 position = corner == 0 ? tri.posA : (corner == 1 ? tri.posB : tri.posC);
+
+    triangleIndex = triangle;
+    gl_Position = ViewProjection * vec4(position, 1.0);
+}
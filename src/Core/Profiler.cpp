@@ -0,0 +1,165 @@
+#include"Profiler.h"
+#include<cstring>
+#include<fstream>
+#include<iomanip>
+#include<iostream>
+
+Profiler::Profiler(int frameLatency, int maxScopesPerFrame)
+	: frameLatency(frameLatency), maxScopesPerFrame(maxScopesPerFrame), pending(frameLatency)
+{
+	// Software rasterizers may report no timer bits, the profiler then keeps the CPU side only
+	glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &timestampBits);
+	if (timestampBits > 0) {
+		queries.resize(static_cast<size_t>(frameLatency) * maxScopesPerFrame * 2);
+		glGenQueries(static_cast<GLsizei>(queries.size()), queries.data());
+		glGetInteger64v(GL_TIMESTAMP, &gpuEpoch);
+	}
+	epoch = std::chrono::steady_clock::now();
+	lastReport = epoch;
+}
+
+double Profiler::CpuMicroseconds() const
+{
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void Profiler::BeginFrame()
+{
+	frame = (frame + 1) % frameLatency;
+	Collect(pending[frame]);
+	openScopes.clear();
+	BeginScope("Frame");
+}
+
+void Profiler::EndFrame()
+{
+	while (!openScopes.empty())
+		EndScope();
+	Report();
+}
+
+void Profiler::BeginScope(const char* name)
+{
+	std::vector<Scope>& scopes = pending[frame];
+
+	Scope scope = { name, static_cast<int>(openScopes.size()), CpuMicroseconds(), 0.0, -1.0, -1.0, -1 };
+	if (timestampBits > 0 && scopes.size() < static_cast<size_t>(maxScopesPerFrame)) {
+		scope.query = static_cast<int>((static_cast<size_t>(frame) * maxScopesPerFrame + scopes.size()) * 2);
+		glQueryCounter(queries[scope.query], GL_TIMESTAMP);
+	}
+
+	openScopes.push_back(static_cast<int>(scopes.size()));
+	scopes.push_back(scope);
+}
+
+void Profiler::EndScope()
+{
+	if (openScopes.empty()) return;
+
+	Scope& scope = pending[frame][openScopes.back()];
+	openScopes.pop_back();
+	if (scope.query >= 0)
+		glQueryCounter(queries[scope.query + 1], GL_TIMESTAMP);
+	scope.cpuEnd = CpuMicroseconds();
+}
+
+//
+// Collect() – Reads the GPU times of a frame issued frameLatency frames ago. The "Frame" scope
+// ends last, so once its query is available all of them are. A frame that isn't done yet is
+// dropped rather than waited for.
+//
+void Profiler::Collect(std::vector<Scope>& scopes)
+{
+	if (scopes.empty()) return;
+
+	bool gpuTimed = scopes[0].query >= 0;
+	if (gpuTimed) {
+		GLint available = 0;
+		glGetQueryObjectiv(queries[scopes[0].query + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			scopes.clear();
+			return;
+		}
+	}
+
+	for (Scope& scope : scopes) {
+		if (scope.query >= 0) {
+			GLuint64 start = 0, end = 0;
+			glGetQueryObjectui64v(queries[scope.query], GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(queries[scope.query + 1], GL_QUERY_RESULT, &end);
+			scope.gpuStart = (static_cast<GLint64>(start) - gpuEpoch) * 1e-3;
+			scope.gpuEnd = (static_cast<GLint64>(end) - gpuEpoch) * 1e-3;
+		}
+
+		auto sum = sums.begin();
+		while (sum != sums.end() && std::strcmp(sum->name, scope.name) != 0)
+			++sum;
+		if (sum == sums.end())
+			sum = sums.insert(sums.end(), Average{ scope.name, 0.0, 0.0 });
+		sum->cpuMilliseconds += (scope.cpuEnd - scope.cpuStart) * 1e-3;
+		if (scope.query >= 0)
+			sum->gpuMilliseconds += (scope.gpuEnd - scope.gpuStart) * 1e-3;
+
+		if (trace.size() < MAX_TRACE_SCOPES)
+			trace.push_back(scope);
+	}
+	summedFrames++;
+	scopes.clear();
+}
+
+void Profiler::Report()
+{
+	auto now = std::chrono::steady_clock::now();
+	if (summedFrames == 0 || std::chrono::duration<float>(now - lastReport).count() < 1.0f)
+		return;
+
+	averages = sums;
+	std::cout << "Profiler (ms/frame, cpu/gpu):" << std::fixed << std::setprecision(2);
+	for (Average& average : averages) {
+		average.cpuMilliseconds /= summedFrames;
+		average.gpuMilliseconds /= summedFrames;
+		std::cout << " " << average.name << " " << average.cpuMilliseconds << "/" << average.gpuMilliseconds;
+	}
+	std::cout << std::endl;
+
+	for (Average& sum : sums)
+		sum.cpuMilliseconds = sum.gpuMilliseconds = 0.0;
+	summedFrames = 0;
+	lastReport = now;
+}
+
+//
+// WriteTrace() – Complete ("X") events on two tracks of one process: the CPU scopes and,
+// on their own row, the GPU scopes. Timestamps and durations are in microseconds.
+//
+bool Profiler::WriteTrace(const char* path) const
+{
+	std::ofstream out(path);
+	if (!out) {
+		std::cerr << "Profiler: can't write " << path << std::endl;
+		return false;
+	}
+
+	out << std::fixed << std::setprecision(3);
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+	for (const Scope& scope : trace) {
+		out << ",\n{\"name\":\"" << scope.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << scope.cpuStart
+			<< ",\"dur\":" << scope.cpuEnd - scope.cpuStart << ",\"args\":{\"depth\":" << scope.depth << "}}";
+		if (scope.query >= 0)
+			out << ",\n{\"name\":\"" << scope.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":" << scope.gpuStart
+				<< ",\"dur\":" << scope.gpuEnd - scope.gpuStart << ",\"args\":{\"depth\":" << scope.depth << "}}";
+	}
+	out << "\n]}\n";
+
+	std::cout << "Profiler: wrote " << trace.size() << " scopes to " << path << std::endl;
+	return true;
+}
+
+void Profiler::Delete()
+{
+	if (!queries.empty())
+		glDeleteQueries(static_cast<GLsizei>(queries.size()), queries.data());
+	queries.clear();
+}
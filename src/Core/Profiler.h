@@ -0,0 +1,88 @@
+#ifndef PROFILER_CLASS_H
+#define PROFILER_CLASS_H
+
+#include<glad/glad.h>
+#include<chrono>
+#include<vector>
+
+// Frame profiler with named, nestable scopes, each timed on the CPU with steady_clock and on the
+// GPU with a pair of GL_TIMESTAMP queries. A frame's queries are read back frameLatency frames
+// later and only once they are available, so profiling never stalls the pipeline. Finished frames
+// feed per-scope averages (printed once per second) and a Chrome / Perfetto trace.
+// Without timer queries (GL_QUERY_COUNTER_BITS of 0) only the CPU times are recorded.
+class Profiler
+{
+public:
+	struct Average {
+		const char* name;
+		double cpuMilliseconds;
+		double gpuMilliseconds;
+	};
+
+	Profiler(int frameLatency = 3, int maxScopesPerFrame = 64);
+
+	// Reads back the oldest frame in flight and opens the "Frame" scope
+	void BeginFrame();
+	// Closes the "Frame" scope, averages are refreshed once per second
+	void EndFrame();
+
+	// name must outlive the profiler, e.g. a string literal
+	void BeginScope(const char* name);
+	void EndScope();
+
+	// Milliseconds per frame of each scope over the last report period, in first-seen order
+	const std::vector<Average>& Averages() const { return averages; }
+
+	// Writes every read back frame as Chrome trace event JSON (chrome://tracing, ui.perfetto.dev)
+	bool WriteTrace(const char* path) const;
+
+	void Delete();
+
+private:
+	struct Scope {
+		const char* name;
+		int depth;
+		double cpuStart, cpuEnd;    // Microseconds since the profiler was created
+		double gpuStart, gpuEnd;    // Same timeline, -1 when the scope wasn't timed on the GPU
+		int query;                  // First of the scope's two queries, -1 if none
+	};
+
+	static const size_t MAX_TRACE_SCOPES = 1 << 20;
+
+	int frameLatency;
+	int maxScopesPerFrame;
+	int frame = 0;
+	GLint timestampBits = 0;
+	std::vector<GLuint> queries;
+
+	// Scopes of the frames in flight, and the open ones of the current frame
+	std::vector<std::vector<Scope>> pending;
+	std::vector<int> openScopes;
+
+	// GPU timestamps are moved onto the CPU timeline with the offset measured at construction
+	std::chrono::steady_clock::time_point epoch;
+	GLint64 gpuEpoch = 0;
+
+	std::vector<Scope> trace;
+	std::vector<Average> sums;
+	std::vector<Average> averages;
+	int summedFrames = 0;
+	std::chrono::steady_clock::time_point lastReport;
+
+	double CpuMicroseconds() const;
+	void Collect(std::vector<Scope>& scopes);
+	void Report();
+};
+
+// Profiles the enclosing C++ scope
+class ProfileScope
+{
+public:
+	ProfileScope(Profiler& profiler, const char* name) : profiler(profiler) { profiler.BeginScope(name); }
+	~ProfileScope() { profiler.EndScope(); }
+
+private:
+	Profiler& profiler;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#include"RingBuffer.h"
+#include<algorithm>
+#include<cstring>
+#include<iostream>
+
+RingBuffer::RingBuffer(GLsizeiptr slotSize, int slotCount)
+	: slotSize(slotSize), fences(slotCount, nullptr)
+{
+	// Every range bound from the buffer starts on an offset valid for both targets
+	GLint uniformAlignment = 1, storageAlignment = 1;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+	alignment = std::max(uniformAlignment, storageAlignment);
+	this->slotSize = (slotSize + alignment - 1) / alignment * alignment;
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &ID);
+	glNamedBufferStorage(ID, this->slotSize * slotCount, nullptr, flags);
+	mapped = static_cast<unsigned char*>(glMapNamedBufferRange(ID, 0, this->slotSize * slotCount, flags));
+}
+
+void RingBuffer::BeginFrame()
+{
+	slot = (slot + 1) % static_cast<int>(fences.size());
+	slotUsed = 0;
+
+	GLsync& fence = fences[slot];
+	if (fence) {
+		// Normally signalled long ago, the loop only runs when the GPU is frames behind
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+}
+
+GLintptr RingBuffer::Write(GLenum target, GLuint binding, const void* data, GLsizeiptr size)
+{
+	if (slot < 0 || slotUsed + size > slotSize) {
+		std::cerr << "RingBuffer slot overflow" << std::endl;
+		return -1;
+	}
+
+	GLintptr offset = slot * slotSize + slotUsed;
+	std::memcpy(mapped + offset, data, size);
+	glBindBufferRange(target, binding, ID, offset, size);
+
+	slotUsed += (size + alignment - 1) / alignment * alignment;
+	return offset;
+}
+
+void RingBuffer::EndFrame()
+{
+	if (slot >= 0)
+		fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void RingBuffer::Delete()
+{
+	for (GLsync& fence : fences) {
+		if (fence) glDeleteSync(fence);
+		fence = nullptr;
+	}
+	glUnmapNamedBuffer(ID);
+	glDeleteBuffers(1, &ID);
+}
@@ -0,0 +1,36 @@
+#ifndef RING_BUFFER_CLASS_H
+#define RING_BUFFER_CLASS_H
+
+#include<glad/glad.h>
+#include<vector>
+
+// Per-frame data in one persistently and coherently mapped buffer, split into slots that are
+// written in turn. A fence per slot keeps the CPU from overwriting data the GPU still reads,
+// so nothing is allocated or mapped after construction.
+class RingBuffer
+{
+public:
+	GLuint ID;
+
+	RingBuffer(GLsizeiptr slotSize, int slotCount = 3);
+
+	// Moves on to the next slot, waiting for the GPU if it still reads it
+	void BeginFrame();
+	// Copies data into the current slot and binds that range to an indexed target
+	// (GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER)
+	GLintptr Write(GLenum target, GLuint binding, const void* data, GLsizeiptr size);
+	// Fences the current slot once the frame's commands using it are submitted
+	void EndFrame();
+
+	void Delete();
+
+private:
+	unsigned char* mapped;
+	GLsizeiptr slotSize;
+	GLsizeiptr slotUsed = 0;
+	GLint alignment;
+	int slot = -1;
+	std::vector<GLsync> fences;
+};
+
+#endif
@@ -1,4 +1,33 @@
 #include"Shader.h"
+#include<chrono>
+#include<cstdint>
+#include<filesystem>
+#include<iomanip>
+
+// Linked programs are cached here as <key>.bin, see LoadProgramBinary()
+static const char* PROGRAM_CACHE_DIRECTORY = "shadercache";
+static const uint32_t PROGRAM_CACHE_MAGIC = 0x42505247;   // "GRPB"
+
+// Header in front of the binary in a cache file
+struct ProgramCacheHeader {
+	uint32_t Magic;
+	uint32_t Format;
+	uint32_t Length;
+	uint32_t Padding;
+};
+
+// FNV-1a, stable across runs and compilers unlike std::hash
+static uint64_t HashString(const std::string& text, uint64_t hash = 14695981039346656037ull) {
+	for (unsigned char c : text) {
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
 
 std::string get_file_contents(const char* filename) {
 	std::ifstream in(filename, std::ios::binary);
@@ -15,11 +44,23 @@ std::string get_file_contents(const char* filename) {
 	throw(errno);
 }
 
+Shader::Shader() : ID(0) {
+}
+
 Shader::Shader(const char* vertexFile, const char* fragmentFile) {
 
 	std::string vertexSource = get_file_contents(vertexFile);
 	std::string fragmentSource = get_file_contents(fragmentFile);
 
+	auto start = std::chrono::steady_clock::now();
+	std::string name = std::string(vertexFile) + " + " + fragmentFile;
+	std::string cacheKey = ProgramCacheKey({ vertexSource, fragmentSource });
+	ID = glCreateProgram();
+	if (LoadProgramBinary(cacheKey)) {
+		std::cout << "Shader cache hit: " << name << " (" << std::fixed << std::setprecision(1) << MillisecondsSince(start) << " ms)" << std::endl;
+		return;
+	}
+
 	const char* vertexShaderSource = vertexSource.c_str();
 	const char* fragmentShaderSource = fragmentSource.c_str();
 
@@ -31,7 +72,7 @@ Shader::Shader(const char* vertexFile, const char* fragmentFile) {
 	glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
 	glCompileShader(fragmentShader);
 
-	ID = glCreateProgram();
+	glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glAttachShader(ID, vertexShader);
 	glAttachShader(ID, fragmentShader);
 	glLinkProgram(ID);
@@ -43,23 +84,57 @@ Shader::Shader(const char* vertexFile, const char* fragmentFile) {
 		glGetProgramInfoLog(ID, 512, NULL, infoLog);
 		std::cerr << "Shader Linking Error:\n" << infoLog << std::endl;
 	}
+	else SaveProgramBinary(cacheKey);
 
+	glDetachShader(ID, vertexShader);
+	glDetachShader(ID, fragmentShader);
 	glDeleteShader(vertexShader);
 	glDeleteShader(fragmentShader);
+	if (success)
+		std::cout << "Shader cache miss: " << name << ", compiled in " << std::fixed << std::setprecision(1) << MillisecondsSince(start) << " ms" << std::endl;
+	else
+		std::cerr << "Shader build failed: " << name << ", not cached" << std::endl;
 }
 
-Shader::Shader(const char* computeFile) {
+Shader::Shader(const char* computeFile) : Shader(computeFile, std::vector<std::string>()) {
+}
+
+Shader::Shader(const char* computeFile, const std::vector<std::string>& defines) {
 
 	std::string computeSource = get_file_contents(computeFile);
 
+	// The defines go right after #version, #line keeps compiler messages on the file's line numbers
+	if (!defines.empty()) {
+		size_t version = computeSource.find("#version");
+		size_t lineEnd = version == std::string::npos ? std::string::npos : computeSource.find('\n', version);
+		if (lineEnd != std::string::npos) {
+			std::string injected;
+			for (const std::string& define : defines)
+				injected += "#define " + define + "\n";
+			injected += "#line 2\n";
+			computeSource.insert(lineEnd + 1, injected);
+		}
+	}
+
+	// The key covers the source with its defines injected, so every define set is cached on its own
+	auto start = std::chrono::steady_clock::now();
+	std::string name = computeFile;
+	for (const std::string& define : defines)
+		name += " " + define;
+	std::string cacheKey = ProgramCacheKey({ computeSource });
+	ID = glCreateProgram();
+	if (LoadProgramBinary(cacheKey)) {
+		std::cout << "Shader cache hit: " << name << " (" << std::fixed << std::setprecision(1) << MillisecondsSince(start) << " ms)" << std::endl;
+		return;
+	}
+
 	const char* computeShaderSource = computeSource.c_str();
 
 	GLuint computeShader = glCreateShader(GL_COMPUTE_SHADER);
 	glShaderSource(computeShader, 1, &computeShaderSource, NULL);
 	glCompileShader(computeShader);
 
-
-	ID = glCreateProgram();
+	glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glAttachShader(ID, computeShader);
 	glLinkProgram(ID);
 
@@ -70,40 +145,122 @@ Shader::Shader(const char* computeFile) {
 		glGetProgramInfoLog(ID, 512, NULL, infoLog);
 		std::cerr << "Shader Linking Error:\n" << infoLog << std::endl;
 	}
+	else SaveProgramBinary(cacheKey);
 
+	glDetachShader(ID, computeShader);
 	glDeleteShader(computeShader);
+	if (success)
+		std::cout << "Shader cache miss: " << name << ", compiled in " << std::fixed << std::setprecision(1) << MillisecondsSince(start) << " ms" << std::endl;
+	else
+		std::cerr << "Shader build failed: " << name << ", not cached" << std::endl;
+}
+
+// Hash of the sources and of the driver, whose binaries are only valid for itself
+std::string Shader::ProgramCacheKey(const std::vector<std::string>& sources) {
+	uint64_t hash = 14695981039346656037ull;
+	for (const std::string& source : sources)
+		hash = HashString(source + '\0', hash);
+	for (GLenum driverString : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+		const char* value = reinterpret_cast<const char*>(glGetString(driverString));
+		hash = HashString(std::string(value ? value : "") + '\0', hash);
+	}
+
+	std::ostringstream key;
+	key << std::hex << std::setw(16) << std::setfill('0') << hash;
+	return key.str();
+}
+
+// Links ID from a cached binary; false when there is none or the driver rejects it
+bool Shader::LoadProgramBinary(const std::string& cacheKey) {
+	GLint formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+	if (formats == 0) return false;
+
+	std::ifstream in(std::string(PROGRAM_CACHE_DIRECTORY) + "/" + cacheKey + ".bin", std::ios::binary);
+	if (!in) return false;
+
+	ProgramCacheHeader header;
+	if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.Magic != PROGRAM_CACHE_MAGIC)
+		return false;
+	std::vector<char> binary(header.Length);
+	if (!in.read(binary.data(), binary.size()))
+		return false;
+
+	glProgramBinary(ID, header.Format, binary.data(), static_cast<GLsizei>(binary.size()));
+	GLint success;
+	glGetProgramiv(ID, GL_LINK_STATUS, &success);
+	if (!success)
+		std::cerr << "Shader cache: binary " << cacheKey << " rejected by the driver, recompiling" << std::endl;
+	return success == GL_TRUE;
+}
+
+void Shader::SaveProgramBinary(const std::string& cacheKey) {
+	GLint length = 0;
+	glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(ID, length, &length, &format, binary.data());
+
+	std::error_code error;
+	std::filesystem::create_directories(PROGRAM_CACHE_DIRECTORY, error);
+	std::ofstream out(std::string(PROGRAM_CACHE_DIRECTORY) + "/" + cacheKey + ".bin", std::ios::binary);
+	if (!out) {
+		std::cerr << "Shader cache: can't write " << cacheKey << std::endl;
+		return;
+	}
+
+	ProgramCacheHeader header = { PROGRAM_CACHE_MAGIC, format, static_cast<uint32_t>(length), 0 };
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(binary.data(), length);
+}
+
+bool Shader::Linked() const {
+	GLint success = GL_FALSE;
+	if (ID != 0) glGetProgramiv(ID, GL_LINK_STATUS, &success);
+	return success == GL_TRUE;
 }
 
 void Shader::Delete() {
 	glDeleteProgram(ID);
 }
 
+GLint Shader::UniformLocation(const char* uniform)
+{
+	auto cached = uniformLocations.find(uniform);
+	if (cached != uniformLocations.end()) return cached->second;
+	if (ID == 0) return -1;
+
+	GLint loc = glGetUniformLocation(ID, uniform);
+	uniformLocations.emplace(uniform, loc);
+	return loc;
+}
+
 void Shader::SetParameterInt(int data, const char* uniform)
 {
-	GLuint loc = glGetUniformLocation(ID, uniform);
-	glUniform1i(loc, data);
+	glUniform1i(UniformLocation(uniform), data);
 }
 
 void Shader::SetParameterFloat(float data, const char* uniform)
 {
-	glUniform1f(glGetUniformLocation(ID, uniform), data);
+	glUniform1f(UniformLocation(uniform), data);
 }
 
 void Shader::SetParameterColor(glm::vec3 data, const char* uniform)
 {
 
-	glUniform3f(glGetUniformLocation(ID, uniform), data.x, data.y, data.z);
+	glUniform3f(UniformLocation(uniform), data.x, data.y, data.z);
 }
 
 void Shader::SetParameterDouble(double data, const char* uniform)
 {
-	glUniform1d(glGetUniformLocation(ID, uniform), data);
+	glUniform1d(UniformLocation(uniform), data);
 }
 
 void Shader::SetParameterSampler(const char* uniform, int textureUnit)
 {
-	GLuint loc = glGetUniformLocation(ID, uniform);
-	glUniform1i(loc, textureUnit);
+	glUniform1i(UniformLocation(uniform), textureUnit);
 }
 
 
@@ -122,6 +279,12 @@ void Shader::Dispatch(GLuint gX, GLuint gY, GLuint gZ) {
 	glMemoryBarrier(GL_ALL_BARRIER_BITS);
 }
 
+void Shader::DispatchIndirect(GLintptr offset) {
+
+	glDispatchComputeIndirect(offset);
+	glMemoryBarrier(GL_ALL_BARRIER_BITS);
+}
+
 void Shader::DeleteSSBOs() {
 	for (auto& buffer : SSBOBuffers) {
 		if(glIsBuffer(buffer)) glDeleteBuffers(1, &buffer);
@@ -18,11 +18,20 @@ public:
 	GLuint ID;
 	std::vector<GLuint> SSBOBuffers;
 
+	// Empty program, for shaders that are assigned once their defines are known
+	Shader();
 	Shader(const char* vertexFile, const char* fragmentFile);
 	Shader(const char* computeFile);
+	// Compute shader with a #define line per entry inserted after the #version line
+	Shader(const char* computeFile, const std::vector<std::string>& defines);
 
 	void Activate(bool compute = false, GLuint gX = 0, GLuint gY = 0, GLuint gZ = 0);
 	void Dispatch(GLuint gX = 0, GLuint gY = 0, GLuint gZ = 0);
+	// Group counts come from the bound GL_DISPATCH_INDIRECT_BUFFER at offset
+	void DispatchIndirect(GLintptr offset);
+
+	// False when compiling or linking failed, e.g. a variant over the shared memory limit
+	bool Linked() const;
 
 	void Delete();
 	template <class T>
@@ -36,6 +45,9 @@ public:
 	template <class T>
 	GLuint UpdateSSBO(T data, int binding);
 
+	// Location of a uniform, looked up once per name
+	GLint UniformLocation(const char* uniform);
+
 	void SetParameterInt(int data, const char* uniform);
 	void SetParameterFloat(float data, const char* uniform);
 	void SetParameterDouble(double data, const char* uniform);
@@ -43,6 +55,14 @@ public:
 	void SetParameterSampler(const char* uniform, int textureUnit);
 
 	void DeleteSSBOs();
+
+private:
+	std::unordered_map<std::string, GLint> uniformLocations;
+
+	// Program binary cache, see Shader.cpp
+	static std::string ProgramCacheKey(const std::vector<std::string>& sources);
+	bool LoadProgramBinary(const std::string& cacheKey);
+	void SaveProgramBinary(const std::string& cacheKey);
 };
 
 template <class T>
@@ -89,6 +89,7 @@ Texture::Texture(GLuint width, GLuint height, GLuint slot, GLuint binding, GLenu
 {
 	type = "diffuse";
 	unit = slot;
+	this->format = format;
 
 	glGenTextures(1, &ID);
 	glActiveTexture(GL_TEXTURE0 + unit);
@@ -101,12 +102,17 @@ Texture::Texture(GLuint width, GLuint height, GLuint slot, GLuint binding, GLenu
 	glTexParameteri(ID, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(ID, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-	glTextureStorage2D(ID, 1, GL_RGBA32F, width, height);
-	glBindImageTexture(binding, ID, 0, GL_FALSE, 0, access, format);
+	glTextureStorage2D(ID, 1, format, width, height);
+	BindImage(binding, access);
 
 	glActiveTexture(GL_TEXTURE0 + 15);
 }
 
+void Texture::BindImage(GLuint binding, GLenum access)
+{
+	glBindImageTexture(binding, ID, 0, GL_FALSE, 0, access, format);
+}
+
 void Texture::texUnit(Shader& shader, const char* uniform)
 {
 	// Gets the location of the uniform
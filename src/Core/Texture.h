@@ -12,10 +12,15 @@ public:
 	GLuint ID;
 	const char* type;
 	GLuint unit;
+	GLenum format = GL_RGBA8;
 
 	Texture(const char* image, const char* texType, GLuint slot);
+	// Storage image of the given format, bound to image unit binding
 	Texture(GLuint width, GLuint height, GLuint slot, GLuint binding, GLenum access = GL_READ_WRITE, GLenum format = GL_RGBA32F);
 
+	// Binds the storage image to another image unit, e.g. to swap ping-pong targets
+	void BindImage(GLuint binding, GLenum access = GL_READ_WRITE);
+
 	// Assigns a texture unit to a texture
 	void texUnit(Shader& shader, const char* uniform);
 	// Binds a texture
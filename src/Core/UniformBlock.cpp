@@ -0,0 +1,65 @@
+#include"UniformBlock.h"
+#include<cstring>
+#include<glm/gtc/type_ptr.hpp>
+
+UniformBlock::UniformBlock(Shader& shader, const char* blockName)
+{
+	GLuint blockIndex = glGetUniformBlockIndex(shader.ID, blockName);
+	if (blockIndex == GL_INVALID_INDEX) {
+		std::cerr << "Uniform block not found: " << blockName << std::endl;
+		return;
+	}
+
+	GLint size = 0, binding = 0, memberCount = 0;
+	glGetActiveUniformBlockiv(shader.ID, blockIndex, GL_UNIFORM_BLOCK_DATA_SIZE, &size);
+	glGetActiveUniformBlockiv(shader.ID, blockIndex, GL_UNIFORM_BLOCK_BINDING, &binding);
+	glGetActiveUniformBlockiv(shader.ID, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &memberCount);
+	Data.assign(size, 0);
+	Binding = binding;
+
+	// std140 keeps every member active, so all of them are listed
+	std::vector<GLint> indices(memberCount);
+	glGetActiveUniformBlockiv(shader.ID, blockIndex, GL_UNIFORM_BLOCK_ACTIVE_UNIFORM_INDICES, indices.data());
+	std::vector<GLuint> members(indices.begin(), indices.end());
+	std::vector<GLint> memberOffsets(memberCount);
+	glGetActiveUniformsiv(shader.ID, memberCount, members.data(), GL_UNIFORM_OFFSET, memberOffsets.data());
+
+	char name[256];
+	for (int i = 0; i < memberCount; i++) {
+		glGetActiveUniformName(shader.ID, members[i], sizeof(name), NULL, name);
+		offsets[name] = memberOffsets[i];
+	}
+}
+
+void UniformBlock::Set(const char* uniform, const void* data, size_t size)
+{
+	auto member = offsets.find(uniform);
+	if (member == offsets.end() || member->second + size > Data.size()) return;
+	std::memcpy(&Data[member->second], data, size);
+}
+
+void UniformBlock::SetParameterInt(int data, const char* uniform)
+{
+	Set(uniform, &data, sizeof(data));
+}
+
+void UniformBlock::SetParameterFloat(float data, const char* uniform)
+{
+	Set(uniform, &data, sizeof(data));
+}
+
+void UniformBlock::SetParameterDouble(double data, const char* uniform)
+{
+	Set(uniform, &data, sizeof(data));
+}
+
+void UniformBlock::SetParameterColor(glm::vec3 data, const char* uniform)
+{
+	Set(uniform, glm::value_ptr(data), sizeof(data));
+}
+
+void UniformBlock::SetParameterMatrix(const glm::mat4& data, const char* uniform)
+{
+	// Column-major with a 16 byte column stride, the same as std140
+	Set(uniform, glm::value_ptr(data), sizeof(data));
+}
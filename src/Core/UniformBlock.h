@@ -0,0 +1,35 @@
+#ifndef UNIFORM_BLOCK_CLASS_H
+#define UNIFORM_BLOCK_CLASS_H
+
+#include<glad/glad.h>
+#include<string>
+#include<vector>
+#include<unordered_map>
+#include<glm/glm.hpp>
+
+#include"Shader.h"
+
+// CPU copy of a std140 uniform block. Member offsets and the block's binding are read from the
+// program once, after which setting a member is a memcpy into Data; uploading it is up to the
+// caller (e.g. RingBuffer::Write). Unknown members are ignored like glUniform* on location -1.
+class UniformBlock
+{
+public:
+	GLuint Binding = 0;
+	std::vector<unsigned char> Data;
+
+	UniformBlock(Shader& shader, const char* blockName);
+
+	void SetParameterInt(int data, const char* uniform);
+	void SetParameterFloat(float data, const char* uniform);
+	void SetParameterDouble(double data, const char* uniform);
+	void SetParameterColor(glm::vec3 data, const char* uniform);
+	void SetParameterMatrix(const glm::mat4& data, const char* uniform);
+
+private:
+	std::unordered_map<std::string, GLint> offsets;
+
+	void Set(const char* uniform, const void* data, size_t size);
+};
+
+#endif
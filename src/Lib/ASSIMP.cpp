@@ -1,6 +1,8 @@
 ﻿#pragma once // Instead of using include guards.
 #include <vector>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 #include<glad/glad.h>
 #include<GLFW/glfw3.h>
 #include<glm/glm.hpp>
@@ -162,7 +164,9 @@ public:
 		const int texWidth = 4096;
 		const int texHeight = 4096;
 
-		glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGB8, texWidth, texHeight, texture_list.size());
+		// Full mip chain, compute.comp picks the level from ray cones
+		const int mipLevels = 1 + static_cast<int>(std::floor(std::log2(std::max(texWidth, texHeight))));
+		glTexStorage3D(GL_TEXTURE_2D_ARRAY, mipLevels, GL_RGB8, texWidth, texHeight, texture_list.size());
 
 		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
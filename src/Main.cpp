@@ -17,10 +17,15 @@
 
 
 
-int main() 
+int main(int argc, char** argv) 
 {
+	// --retune-workgroups: time the compute workgroup sizes again instead of using the cached choice
+	bool retuneWorkgroups = false;
+	for (int i = 1; i < argc; i++)
+		if (std::string(argv[i]) == "--retune-workgroups") retuneWorkgroups = true;
+
 	Window win("Metropolis", 1400, 800);
-	RayScene scene(win);
+	RayScene scene(win, retuneWorkgroups);
 
 	scene.OnWindowLoad(win);
 
@@ -26,6 +26,40 @@ struct EmissivePowerInfo {
     glm::vec2 padding;
 };
 
+// Number of persistent primary sample coordinates per Metropolis chain.
+// Must match MAX_PSS_DIMS in compute.comp.
+const int MLT_MAX_PSS_DIMS = 32;
+
+//-----------------------------------------------------------------------------
+// PrimarySample
+//-----------------------------------------------------------------------------
+// One coordinate of a chain's primary sample vector, with the backup used
+// to roll back a rejected proposal.
+struct PrimarySample {
+    float value;
+    int lastModification;
+    float backupValue;
+    int backupModification;
+};
+
+//-----------------------------------------------------------------------------
+// MLTChain
+//-----------------------------------------------------------------------------
+// Persistent state of one primary sample space Metropolis chain. Lives on the
+// GPU only; the host just sizes the buffer.
+struct alignas(16) MLTChain {
+    // Current path contribution (rgb) and its luminance (a).
+    glm::vec4 contribution;
+    // Pixel the current path lands in.
+    glm::ivec2 pixel;
+    int iteration;
+    int lastLargeStep;
+    unsigned int largeStepSeed;
+    unsigned int rngState;
+    glm::vec2 padding;
+    PrimarySample samples[MLT_MAX_PSS_DIMS];
+};
+
 //-----------------------------------------------------------------------------
 // Material
 //-----------------------------------------------------------------------------
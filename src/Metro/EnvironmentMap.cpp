@@ -0,0 +1,164 @@
+#include "EnvironmentMap.h"
+#include <stb/stb_image.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+// Header of the .cdf cache; the image's size and last write time invalidate caches of replaced images
+struct EnvironmentCdfHeader {
+    uint32_t Magic;
+    uint32_t Version;
+    int32_t Width;
+    int32_t Height;
+    uint64_t ImageSize;
+    int64_t ImageWriteTime;
+    float Integral;
+    float Padding;
+};
+
+static const uint32_t CDF_MAGIC = 0x46444345;   // "ECDF"
+static const uint32_t CDF_VERSION = 2;
+
+EnvironmentMap::~EnvironmentMap() {
+    const GLuint textures[3] = { radianceTexture, marginalTexture, conditionalTexture };
+    glDeleteTextures(3, textures);
+}
+
+bool EnvironmentMap::Load(const std::string& path) {
+    // stb's flip flag is global; equirectangular maps are stored zenith row first
+    stbi_set_flip_vertically_on_load(false);
+
+    int channels;
+    float* pixels = stbi_loadf(path.c_str(), &Width, &Height, &channels, 3);
+    if (!pixels) {
+        std::cerr << "Failed to load environment map: " << path << "\n";
+        return false;
+    }
+    std::vector<float> rgb(pixels, pixels + 3 * Width * Height);
+    stbi_image_free(pixels);
+
+    std::error_code error;
+    unsigned long long imageSize = std::filesystem::file_size(path, error);
+    long long imageWriteTime = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+    std::string cachePath = path + ".cdf";
+    if (!LoadCdfCache(cachePath, imageSize, imageWriteTime)) {
+        BuildCdf(rgb);
+        SaveCdfCache(cachePath, imageSize, imageWriteTime);
+    }
+
+    radianceTexture = CreateFloatTexture(GL_RGB32F, GL_RGB, Width, Height, rgb.data());
+    marginalTexture = CreateFloatTexture(GL_R32F, GL_RED, Height + 1, 1, marginalCdf.data());
+    conditionalTexture = CreateFloatTexture(GL_R32F, GL_RED, Width + 1, Height, conditionalCdf.data());
+    return true;
+}
+
+void EnvironmentMap::Bind(Shader& shader) {
+    const GLuint textures[3] = { radianceTexture, marginalTexture, conditionalTexture };
+    const char* uniforms[3] = { "EnvironmentMap", "EnvironmentMarginalCdf", "EnvironmentConditionalCdf" };
+
+    shader.Activate();
+    for (int i = 0; i < 3; i++) {
+        glActiveTexture(GL_TEXTURE0 + TEXTURE_UNIT + i);
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+        shader.SetParameterSampler(uniforms[i], TEXTURE_UNIT + i);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+//
+// BuildCdf() – Texel weights are luminance * sin(theta) at the row centre, matching
+// EnvironmentPdf() in compute.comp. Rows without energy fall back to uniform.
+//
+void EnvironmentMap::BuildCdf(const std::vector<float>& rgb) {
+    conditionalCdf.assign(static_cast<size_t>(Height) * (Width + 1), 0.0f);
+    marginalCdf.assign(Height + 1, 0.0f);
+
+    std::vector<double> rowSums(Height, 0.0);
+    for (int y = 0; y < Height; y++) {
+        float sinTheta = std::sin(glm::pi<float>() * (y + 0.5f) / Height);
+        float* row = &conditionalCdf[static_cast<size_t>(y) * (Width + 1)];
+
+        double sum = 0.0;
+        std::vector<double> cumulative(Width + 1, 0.0);
+        for (int x = 0; x < Width; x++) {
+            const float* texel = &rgb[3 * (static_cast<size_t>(y) * Width + x)];
+            float luminance = 0.2126f * texel[0] + 0.7152f * texel[1] + 0.0722f * texel[2];
+            sum += std::max(luminance, 0.0f) * sinTheta;
+            cumulative[x + 1] = sum;
+        }
+
+        for (int x = 0; x <= Width; x++)
+            row[x] = sum > 0.0 ? static_cast<float>(cumulative[x] / sum) : static_cast<float>(x) / Width;
+        row[Width] = 1.0f;
+        rowSums[y] = sum;
+    }
+
+    double total = 0.0;
+    std::vector<double> cumulative(Height + 1, 0.0);
+    for (int y = 0; y < Height; y++) {
+        total += rowSums[y];
+        cumulative[y + 1] = total;
+    }
+    for (int y = 0; y <= Height; y++)
+        marginalCdf[y] = total > 0.0 ? static_cast<float>(cumulative[y] / total) : static_cast<float>(y) / Height;
+    marginalCdf[Height] = 1.0f;
+
+    Integral = static_cast<float>(total);
+}
+
+bool EnvironmentMap::LoadCdfCache(const std::string& cachePath, unsigned long long imageSize, long long imageWriteTime) {
+    std::ifstream file(cachePath, std::ios::binary);
+    if (!file)
+        return false;
+
+    EnvironmentCdfHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        return false;
+    if (header.Magic != CDF_MAGIC || header.Version != CDF_VERSION || header.Width != Width ||
+        header.Height != Height || header.ImageSize != imageSize || header.ImageWriteTime != imageWriteTime)
+        return false;
+
+    marginalCdf.resize(Height + 1);
+    conditionalCdf.resize(static_cast<size_t>(Height) * (Width + 1));
+    if (!file.read(reinterpret_cast<char*>(marginalCdf.data()), marginalCdf.size() * sizeof(float)) ||
+        !file.read(reinterpret_cast<char*>(conditionalCdf.data()), conditionalCdf.size() * sizeof(float)))
+        return false;
+
+    Integral = header.Integral;
+    return true;
+}
+
+void EnvironmentMap::SaveCdfCache(const std::string& cachePath, unsigned long long imageSize, long long imageWriteTime) const {
+    std::ofstream file(cachePath, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to write environment CDF cache: " << cachePath << "\n";
+        return;
+    }
+
+    EnvironmentCdfHeader header = { CDF_MAGIC, CDF_VERSION, Width, Height, imageSize, imageWriteTime, Integral, 0.0f };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(marginalCdf.data()), marginalCdf.size() * sizeof(float));
+    file.write(reinterpret_cast<const char*>(conditionalCdf.data()), conditionalCdf.size() * sizeof(float));
+}
+
+GLuint EnvironmentMap::CreateFloatTexture(GLenum internalFormat, GLenum format, int width, int height, const float* data) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    // Texels are fetched directly, the distribution is piecewise constant
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_FLOAT, data);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
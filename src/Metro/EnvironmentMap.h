@@ -0,0 +1,42 @@
+#pragma once
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+#include "../Core/Shader.h"
+
+//
+// EnvironmentMap – Equirectangular HDR sky light. Rows run from the zenith (top) to the nadir,
+// columns over phi. Alongside the radiance a piecewise-constant 2D distribution proportional to
+// luminance * sin(theta) is built (marginal CDF over rows, conditional CDF per row) so that the
+// shader can importance sample the sky. The CDFs are cached next to the image as <image>.cdf.
+//
+class EnvironmentMap {
+public:
+    ~EnvironmentMap();
+
+    // Loads the image and its CDFs (from the cache when it is valid); false if the image can't be read
+    bool Load(const std::string& path);
+
+    // Binds the radiance and CDF textures to three consecutive units starting at TEXTURE_UNIT
+    void Bind(Shader& shader);
+
+    int Width = 0;
+    int Height = 0;
+    float Integral = 0.0f;      // Sum of luminance * sin(theta) over all texels
+
+    static const GLuint TEXTURE_UNIT = 10;
+
+private:
+    GLuint radianceTexture = 0;
+    GLuint marginalTexture = 0;
+    GLuint conditionalTexture = 0;
+
+    std::vector<float> marginalCdf;      // Height + 1 entries
+    std::vector<float> conditionalCdf;   // Height rows of Width + 1 entries
+
+    void BuildCdf(const std::vector<float>& rgb);
+    bool LoadCdfCache(const std::string& cachePath, unsigned long long imageSize, long long imageWriteTime);
+    void SaveCdfCache(const std::string& cachePath, unsigned long long imageSize, long long imageWriteTime) const;
+    static GLuint CreateFloatTexture(GLenum internalFormat, GLenum format, int width, int height, const float* data);
+};
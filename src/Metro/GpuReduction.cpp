@@ -0,0 +1,111 @@
+#include "GpuReduction.h"
+#include <algorithm>
+#include <vector>
+
+GpuReduction::GpuReduction() :
+    shader("shaders/reduction.comp")
+{
+    std::vector<float> results(MAX_RESULTS, 0.0f);
+    std::vector<float> partials(MAX_GROUPS, 0.0f);
+    std::vector<GLuint> histogram(HISTOGRAM_BINS, 0);
+
+    glCreateBuffers(1, &resultBuffer);
+    glCreateBuffers(1, &partialBuffer);
+    glCreateBuffers(1, &histogramBuffer);
+    glNamedBufferData(resultBuffer, results.size() * sizeof(float), results.data(), GL_DYNAMIC_COPY);
+    glNamedBufferData(partialBuffer, partials.size() * sizeof(float), partials.data(), GL_DYNAMIC_COPY);
+    glNamedBufferData(histogramBuffer, histogram.size() * sizeof(GLuint), histogram.data(), GL_DYNAMIC_COPY);
+    BindBuffers();
+}
+
+GpuReduction::~GpuReduction() {
+    glDeleteBuffers(1, &resultBuffer);
+    glDeleteBuffers(1, &partialBuffer);
+    glDeleteBuffers(1, &histogramBuffer);
+    shader.Delete();
+}
+
+void GpuReduction::BindBuffers() {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, RESULT_BINDING, resultBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PARTIAL_BINDING, partialBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, HISTOGRAM_BINDING, histogramBuffer);
+}
+
+int GpuReduction::GroupCount(int count) {
+    return std::clamp((count + GROUP_SIZE - 1) / GROUP_SIZE, 1, MAX_GROUPS);
+}
+
+void GpuReduction::ReduceImage(GLuint texture, int width, int height, glm::vec4 weights, bool mean, int resultSlot) {
+    shader.Activate();
+    glBindTextureUnit(TEXTURE_UNIT, texture);
+    shader.SetParameterSampler("InputImage", TEXTURE_UNIT);
+    shader.SetParameterInt(width, "ImageWidth");
+    glUniform4f(shader.UniformLocation("ImageWeights"), weights.x, weights.y, weights.z, weights.w);
+
+    Reduce(PASS_IMAGE, width * height, mean, resultSlot);
+}
+
+void GpuReduction::ReduceBuffer(GLuint buffer, int count, int offset, int stride, bool mean, int resultSlot) {
+    shader.Activate();
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INPUT_BINDING, buffer);
+    shader.SetParameterInt(offset, "InputOffset");
+    shader.SetParameterInt(stride, "InputStride");
+
+    Reduce(PASS_BUFFER, count, mean, resultSlot);
+}
+
+//
+// Reduce() – One partial sum per workgroup, then a single workgroup adds the partials up.
+// Each thread loops over as many elements as needed, so two dispatches cover any count.
+//
+void GpuReduction::Reduce(Pass pass, int count, bool mean, int resultSlot) {
+    BindBuffers();
+    int groups = GroupCount(count);
+
+    shader.SetParameterInt(pass, "ReductionPass");
+    shader.SetParameterInt(count, "ElementCount");
+    shader.Dispatch(groups, 1, 1);
+
+    shader.SetParameterInt(PASS_FINAL, "ReductionPass");
+    shader.SetParameterInt(groups, "ElementCount");
+    shader.SetParameterInt(resultSlot, "ResultSlot");
+    shader.SetParameterFloat(mean ? static_cast<float>(std::max(count, 1)) : 1.0f, "Divisor");
+    shader.Dispatch(1, 1, 1);
+}
+
+void GpuReduction::AccumulateHistogram(GLuint texture, int width, int height) {
+    shader.Activate();
+    BindBuffers();
+    glBindTextureUnit(TEXTURE_UNIT, texture);
+    shader.SetParameterSampler("InputImage", TEXTURE_UNIT);
+    shader.SetParameterInt(width, "ImageWidth");
+    shader.SetParameterFloat(MIN_LOG_LUMINANCE, "MinLogLuminance");
+    shader.SetParameterFloat(LOG_LUMINANCE_RANGE, "LogLuminanceRange");
+
+    shader.SetParameterInt(PASS_HISTOGRAM, "ReductionPass");
+    shader.SetParameterInt(width * height, "ElementCount");
+    shader.Dispatch(GroupCount(width * height), 1, 1);
+}
+
+void GpuReduction::UpdateExposure(int resultSlot, float adaptation, float lowPercentile, float highPercentile) {
+    shader.Activate();
+    BindBuffers();
+    shader.SetParameterFloat(MIN_LOG_LUMINANCE, "MinLogLuminance");
+    shader.SetParameterFloat(LOG_LUMINANCE_RANGE, "LogLuminanceRange");
+    shader.SetParameterFloat(lowPercentile, "LowPercentile");
+    shader.SetParameterFloat(highPercentile, "HighPercentile");
+    shader.SetParameterFloat(adaptation, "Adaptation");
+    shader.SetParameterInt(resultSlot, "ResultSlot");
+
+    shader.SetParameterInt(PASS_EXPOSURE, "ReductionPass");
+    shader.Dispatch(1, 1, 1);
+}
+
+void GpuReduction::CopyResultToTexel(int resultSlot, GLuint texture, int x, int y) {
+    // The copy is sourced from the result buffer as a pixel unpack buffer, it never touches the CPU
+    glMemoryBarrier(GL_PIXEL_BUFFER_BARRIER_BIT);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, resultBuffer);
+    glTextureSubImage2D(texture, 0, x, y, 1, 1, GL_RED, GL_FLOAT,
+        reinterpret_cast<const void*>(static_cast<size_t>(resultSlot) * sizeof(float)));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "../Core/Shader.h"
+
+//
+// GpuReduction – Sums, means and luminance histograms computed on the GPU by reduction.comp.
+// Results stay in a small SSBO (binding RESULT_BINDING) that other shaders read directly, so
+// nothing is read back to the CPU. Every call leaves the reduction program active.
+//
+class GpuReduction {
+public:
+    GpuReduction();
+    ~GpuReduction();
+
+    // Sum (or mean) of dot(texel, weights) over the top-left width x height texels of a texture
+    void ReduceImage(GLuint texture, int width, int height, glm::vec4 weights, bool mean, int resultSlot);
+
+    // Sum (or mean) of buffer[offset + i * stride] for i < count, the buffer holding floats
+    void ReduceBuffer(GLuint buffer, int count, int offset, int stride, bool mean, int resultSlot);
+
+    // Adds the texture's log2 luminance histogram to the histogram buffer
+    void AccumulateHistogram(GLuint texture, int width, int height);
+
+    // Turns the histogram into the average luminance between the percentiles, blends it into
+    // resultSlot with the given adaptation factor and clears the histogram
+    void UpdateExposure(int resultSlot, float adaptation, float lowPercentile, float highPercentile);
+
+    // Copies a result into the red channel of a texel, e.g. for shaders that read it from an image
+    void CopyResultToTexel(int resultSlot, GLuint texture, int x, int y);
+
+    static const int RESULT_BINDING = 37;
+    static const int MAX_RESULTS = 16;
+    static const int HISTOGRAM_BINS = 64;     // Must match HISTOGRAM_BINS in reduction.comp
+    static constexpr float MIN_LOG_LUMINANCE = -10.0f;
+    static constexpr float LOG_LUMINANCE_RANGE = 12.0f;
+
+private:
+    static const int PARTIAL_BINDING = 38;
+    static const int HISTOGRAM_BINDING = 39;
+    static const int INPUT_BINDING = 40;
+    static const int TEXTURE_UNIT = 13;
+    static constexpr int GROUP_SIZE = 256;        // Must match GROUP_SIZE in reduction.comp
+    static constexpr int MAX_GROUPS = 256;        // The final pass sums at most this many partials
+
+    // Must match REDUCTION_PASS_* in reduction.comp
+    enum Pass {
+        PASS_IMAGE = 0,
+        PASS_BUFFER = 1,
+        PASS_FINAL = 2,
+        PASS_HISTOGRAM = 3,
+        PASS_EXPOSURE = 4
+    };
+
+    Shader shader;
+    GLuint resultBuffer = 0;
+    GLuint partialBuffer = 0;
+    GLuint histogramBuffer = 0;
+
+    void BindBuffers();
+    void Reduce(Pass pass, int count, bool mean, int resultSlot);
+    static int GroupCount(int count);
+};
@@ -0,0 +1,189 @@
+#include "PathGuiding.h"
+#include <cmath>
+#include <cstdint>
+
+PathGuiding::PathGuiding(glm::vec3 boundsMin, glm::vec3 boundsMax, int trainingIterations,
+    float spatialThreshold, float energyThreshold) :
+    BoundsMin(boundsMin),
+    BoundsMax(boundsMax),
+    trainingIterations(trainingIterations),
+    spatialThreshold(spatialThreshold),
+    energyThreshold(energyThreshold)
+{
+    // Start with a single spatial leaf, no sampling tree and a root-only training tree
+    spatialNodes.resize(1);
+
+    glCreateBuffers(1, &nodeBuffer);
+    glCreateBuffers(1, &counterBuffer);
+    Upload();
+}
+
+PathGuiding::~PathGuiding() {
+    glDeleteBuffers(1, &nodeBuffer);
+    glDeleteBuffers(1, &counterBuffer);
+}
+
+//
+// EndFrame() – Iteration k trains for 2^k frames, so later iterations gather more samples
+// into the finer trees produced by the earlier ones.
+//
+void PathGuiding::EndFrame() {
+    if (!IsTraining())
+        return;
+
+    if (++framesInIteration < (1 << iteration))
+        return;
+
+    Refine();
+    iteration++;
+    framesInIteration = 0;
+    Upload();
+}
+
+//
+// Refine() – Reads the training counters back, promotes the learned quadtrees to sampling
+// trees and rebuilds the spatial and directional structure for the next iteration.
+//
+void PathGuiding::Refine() {
+    GLint counterSize = 0;
+    glGetNamedBufferParameteriv(counterBuffer, GL_BUFFER_SIZE, &counterSize);
+    std::vector<GLuint> counters(counterSize / sizeof(GLuint));
+    glGetNamedBufferSubData(counterBuffer, 0, counterSize, counters.data());
+
+    // Every node quadrant holds a 64 bit fixed-point sum split into (lo, hi)
+    auto counter = [&](int node, int quadrant) {
+        size_t index = 2 * (static_cast<size_t>(node) * 4 + quadrant);
+        return static_cast<double>((static_cast<uint64_t>(counters[index + 1]) << 32) | counters[index]);
+    };
+
+    for (size_t i = 0; i < spatialNodes.size(); i++) {
+        SpatialNode& leaf = spatialNodes[i];
+        if (leaf.FirstChild >= 0)
+            continue;
+
+        leaf.Samples = counter(static_cast<int>(i), 0);
+
+        DirectionalTree& training = leaf.Training;
+        for (size_t n = 0; n < training.Nodes.size(); n++)
+            for (int q = 0; q < 4; q++)
+                training.Nodes[n].Energy[q] = counter(trainingOffsets[i] + static_cast<int>(n), q) / RECORD_SCALE;
+
+        // Leaves that saw no light keep their previous distribution
+        if (training.Total() > 0.0) {
+            leaf.Sampling = training;
+            leaf.HasSamplingTree = true;
+        }
+    }
+
+    // The split threshold grows with the square root of the iteration length, as in the paper
+    SplitSpatialLeaf(0, 0, spatialThreshold * std::sqrt(static_cast<double>(1 << iteration)));
+
+    for (SpatialNode& node : spatialNodes) {
+        if (node.FirstChild >= 0)
+            continue;
+        node.Training = node.HasSamplingTree ? RefineDirectional(node.Sampling, energyThreshold) : DirectionalTree();
+    }
+}
+
+//
+// SplitSpatialLeaf() – Halves leaves along alternating axes until each holds fewer samples than the
+// threshold. Both children start from a copy of the parent's quadtree and half its samples.
+//
+void PathGuiding::SplitSpatialLeaf(int node, int depth, double threshold) {
+    if (spatialNodes[node].FirstChild >= 0) {
+        int firstChild = spatialNodes[node].FirstChild;
+        SplitSpatialLeaf(firstChild, depth + 1, threshold);
+        SplitSpatialLeaf(firstChild + 1, depth + 1, threshold);
+        return;
+    }
+
+    if (spatialNodes[node].Samples <= threshold || depth >= MAX_SPATIAL_DEPTH)
+        return;
+
+    SpatialNode child = spatialNodes[node];
+    child.Axis = (spatialNodes[node].Axis + 1) % 3;
+    child.Samples *= 0.5;
+
+    // push_back may reallocate, so the parent is only touched through its index
+    int firstChild = static_cast<int>(spatialNodes.size());
+    spatialNodes.push_back(child);
+    spatialNodes.push_back(child);
+
+    spatialNodes[node].FirstChild = firstChild;
+    spatialNodes[node].Sampling = DirectionalTree();
+    spatialNodes[node].Training = DirectionalTree();
+    spatialNodes[node].HasSamplingTree = false;
+
+    SplitSpatialLeaf(firstChild, depth + 1, threshold);
+    SplitSpatialLeaf(firstChild + 1, depth + 1, threshold);
+}
+
+//
+// RefineDirectional() – Builds an empty training quadtree whose cells are subdivided wherever
+// the learned tree holds more than energyThreshold of the total energy.
+//
+DirectionalTree PathGuiding::RefineDirectional(const DirectionalTree& learned, float energyThreshold) {
+    DirectionalTree refined;
+    double total = learned.Total();
+    if (total > 0.0)
+        RefineDirectionalNode(learned, 0, total, total, energyThreshold, 1, refined, 0);
+    return refined;
+}
+
+void PathGuiding::RefineDirectionalNode(const DirectionalTree& learned, int learnedNode, double regionEnergy,
+    double total, float energyThreshold, int depth, DirectionalTree& refined, int refinedNode) {
+    for (int q = 0; q < 4; q++) {
+        // Below a learned leaf the energy is assumed to be spread evenly
+        double energy = learnedNode >= 0 ? learned.Nodes[learnedNode].Energy[q] : regionEnergy * 0.25;
+        if (depth >= MAX_DIRECTIONAL_DEPTH || energy / total <= energyThreshold)
+            continue;
+
+        int child = static_cast<int>(refined.Nodes.size());
+        refined.Nodes.emplace_back();
+        refined.Nodes[refinedNode].Children[q] = child;
+
+        int learnedChild = learnedNode >= 0 ? learned.Nodes[learnedNode].Children[q] : -1;
+        RefineDirectionalNode(learned, learnedChild, energy, total, energyThreshold, depth + 1, refined, child);
+    }
+}
+
+//
+// Upload() – Flattens the spatial tree followed by every leaf's quadtrees into the node buffer
+// and allocates zeroed training counters for all of them.
+//
+void PathGuiding::Upload() {
+    std::vector<GuideNode> nodes(spatialNodes.size());
+    trainingOffsets.assign(spatialNodes.size(), -1);
+
+    auto append = [&nodes](const DirectionalTree& tree) {
+        int base = static_cast<int>(nodes.size());
+        for (const DirectionalTree::Node& node : tree.Nodes) {
+            GuideNode gpuNode;
+            for (int q = 0; q < 4; q++) {
+                gpuNode.Energy[q] = static_cast<float>(node.Energy[q]);
+                gpuNode.Children[q] = node.Children[q] >= 0 ? base + node.Children[q] : -1;
+            }
+            nodes.push_back(gpuNode);
+        }
+        return base;
+    };
+
+    for (size_t i = 0; i < spatialNodes.size(); i++) {
+        const SpatialNode& node = spatialNodes[i];
+        nodes[i].Children = glm::ivec4(node.FirstChild, node.Axis, -1, -1);
+        if (node.FirstChild >= 0)
+            continue;
+
+        if (node.HasSamplingTree)
+            nodes[i].Children.z = append(node.Sampling);
+        trainingOffsets[i] = append(node.Training);
+        nodes[i].Children.w = trainingOffsets[i];
+    }
+
+    std::vector<GLuint> counters(nodes.size() * 4 * 2, 0);
+
+    glNamedBufferData(nodeBuffer, nodes.size() * sizeof(GuideNode), nodes.data(), GL_DYNAMIC_DRAW);
+    glNamedBufferData(counterBuffer, counters.size() * sizeof(GLuint), counters.data(), GL_DYNAMIC_COPY);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, NODE_BINDING, nodeBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, COUNTER_BINDING, counterBuffer);
+}
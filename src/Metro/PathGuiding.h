@@ -0,0 +1,93 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <vector>
+
+// Node of the guiding tree as read by compute.comp (binding 31).
+// Directional nodes: Energy holds the learned energy of each quadrant and Children
+// the child node per quadrant (-1 = leaf).
+// Spatial nodes: Children = (first child or -1, split axis, sampling tree, training tree),
+// the second child follows the first one.
+struct alignas(16) GuideNode {
+    glm::vec4 Energy = glm::vec4(0.0f);
+    glm::ivec4 Children = glm::ivec4(-1);
+};
+
+// Quadtree over the cylindrical (cos theta, phi) parameterisation of the sphere of directions
+struct DirectionalTree {
+    struct Node {
+        std::array<double, 4> Energy = { 0.0, 0.0, 0.0, 0.0 };
+        std::array<int, 4> Children = { -1, -1, -1, -1 };
+    };
+
+    std::vector<Node> Nodes = std::vector<Node>(1);  // Nodes[0] is the root
+
+    double Total() const {
+        const Node& root = Nodes[0];
+        return root.Energy[0] + root.Energy[1] + root.Energy[2] + root.Energy[3];
+    }
+};
+
+// Binary tree over the scene bounds; every leaf owns a sampling and a training quadtree
+struct SpatialNode {
+    int FirstChild = -1;
+    int Axis = 0;
+    double Samples = 0.0;
+    bool HasSamplingTree = false;
+    DirectionalTree Sampling;
+    DirectionalTree Training;
+};
+
+//
+// PathGuiding – SD-tree in the style of Practical Path Guiding (Müller et al. 2017).
+// The GPU records incident radiance into the training quadtrees while rendering; at the end
+// of every training iteration the counters are read back, the learned quadtrees become the
+// sampling distribution, the spatial tree is split where it received many samples, and fresh
+// training quadtrees are refined where the learned energy is concentrated.
+//
+class PathGuiding {
+public:
+    PathGuiding(glm::vec3 boundsMin, glm::vec3 boundsMax, int trainingIterations,
+        float spatialThreshold, float energyThreshold);
+    ~PathGuiding();
+
+    // True while radiance is being recorded into the training trees
+    bool IsTraining() const { return iteration < trainingIterations; }
+
+    // Counts the frame towards the current iteration and refines the trees when it ends
+    void EndFrame();
+
+    glm::vec3 BoundsMin;
+    glm::vec3 BoundsMax;
+
+    // Fixed-point scale of the training counters, passed to compute.comp as GuidingRecordScale
+    static constexpr float RECORD_SCALE = 65536.0f;
+
+private:
+    static const int NODE_BINDING = 31;
+    static const int COUNTER_BINDING = 32;
+    static const int MAX_SPATIAL_DEPTH = 24;
+    static const int MAX_DIRECTIONAL_DEPTH = 20;
+
+    std::vector<SpatialNode> spatialNodes;
+    GLuint nodeBuffer = 0;
+    GLuint counterBuffer = 0;
+
+    // Offset of every leaf's training tree in the last upload, used to read back the counters
+    std::vector<int> trainingOffsets;
+
+    int trainingIterations;
+    float spatialThreshold;
+    float energyThreshold;
+    int iteration = 0;
+    int framesInIteration = 0;
+
+    void Refine();
+    void SplitSpatialLeaf(int node, int depth, double threshold);
+    void Upload();
+
+    static DirectionalTree RefineDirectional(const DirectionalTree& learned, float energyThreshold);
+    static void RefineDirectionalNode(const DirectionalTree& learned, int learnedNode, double regionEnergy,
+        double total, float energyThreshold, int depth, DirectionalTree& refined, int refinedNode);
+};
@@ -1,6 +1,8 @@
 ﻿#include "RayScene.h"
 #include "ComputeStructures.h"
+#include <algorithm>
 #include <chrono>
+#include <limits>
 #include "../Core/Text.h"
 #include "../../stb_image_write.h"
 
@@ -30,13 +32,137 @@ const int BIDIRECTIONALMAXPATHS = 10;
 const int LENSSUBPATHS = 8;
 const int LIGHTSUBPATHS = 8;
 
+// Path regeneration (PATH_TRACING): lanes start a new sample when their path terminates, until
+// RAYSPERPIXEL * BOUNCES bounces ran, instead of waiting for the longest path of their warp
+const bool PATH_REGENERATION = true;
+
+// Persistent threads: screen passes launch only enough workgroups to fill the GPU, which then
+// take 8x8 tiles from an atomic counter until the frame is covered
+const bool PERSISTENT_THREADS = true;
+const int PERSISTENT_WORKGROUPS = 1024;       // Used when the driver doesn't report its SM count
+
+// Temporal reprojection: keep accumulated samples when the camera moves
+const bool TEMPORAL_REPROJECTION = true;
+const float REPROJECTION_TOLERANCE = 0.02f;   // Relative first-hit distance for disocclusion rejection
+const int REPROJECTION_MAX_HISTORY = 100000;  // Per-pixel history length clamp
+
+// Render target formats. The accumulation targets keep a running average in rgb and the sample
+// count in alpha; GL_RGBA16F halves their bandwidth but counts only up to 2048 exactly, so the
+// history is then clamped to HALF_FLOAT_MAX_HISTORY. The Metropolis samples are colors plus a
+// luminance and fit half floats, the mutated directions are UVs that need full precision.
+const GLenum ACCUMULATION_FORMAT = GL_RGBA32F;
+const int HALF_FLOAT_MAX_HISTORY = 1024;
+const GLenum METROPOLIS_SAMPLE_FORMAT = GL_RGBA16F;
+const GLenum METROPOLIS_DIRECTION_FORMAT = GL_RG32F;
+
+// Primary sample space Metropolis (Kelemen)
+const int MLT_CHAINS = 65536;                 // Independent Markov chains
+const int MLT_BOOTSTRAP_SAMPLES = 1 << 18;    // Paths traced to estimate b and seed the chains
+const int MLT_MUTATIONS_PER_CHAIN = 16;       // Mutations per chain per frame
+const float MLT_LARGE_STEP_PROBABILITY = 0.3f;
+const float MLT_SIGMA = 0.01f;                // Small step standard deviation
+
+// Splat buffer shared by the Metropolis modes and light tracing
+const float SPLAT_SCALE = 1024.0f;            // Fixed-point scale of the atomic RGB counters, see SPLAT_MAX_VALUE in compute.comp
+
+// Light tracing
+const int LIGHT_TRACING_PATHS = 1 << 18;      // Light paths traced per frame
+
+// Bidirectional path tracing with a light vertex cache
+const int LVC_LIGHT_PATHS = 65536;            // Light subpaths traced per frame and shared by all pixels
+const int LVC_CONNECTIONS = 3;                // Cached vertices each camera vertex connects to
+
+// ReSTIR direct lighting and GI
+const int RESTIR_CANDIDATES = 32;             // Initial light candidates per pixel (DI)
+const bool RESTIR_TEMPORAL_REUSE = true;
+const int RESTIR_TEMPORAL_MAX_M = 20;         // History clamp relative to the new candidates
+const int RESTIR_SPATIAL_SAMPLES = 5;         // Neighbour reservoirs merged per pixel
+const float RESTIR_SPATIAL_RADIUS = 30.0f;    // In pixels
+const float RESTIR_MAX_JACOBIAN = 10.0f;      // GI reuse is rejected when the Jacobian leaves [1/x, x]
+
+// Path guiding (SD-tree trained during the first frames), path tracing mode only
+const bool PATH_GUIDING = true;
+const int GUIDING_TRAINING_ITERATIONS = 8;         // Iteration k trains for 2^k frames, 255 frames in total
+const float GUIDING_BSDF_FRACTION = 0.5f;          // One-sample MIS probability of cosine sampling
+const float GUIDING_SPATIAL_THRESHOLD = 12000.0f;  // Leaves split beyond this many samples times sqrt(2^k)
+const float GUIDING_ENERGY_THRESHOLD = 0.01f;      // Quadrants holding more of the energy are subdivided
+
+// World-space radiance cache, path tracing mode only. Biased: paths end in cached radiance.
+const bool RADIANCE_CACHE = true;
+const int RADIANCE_CACHE_ENTRIES = 1 << 20;              // Hash table slots, 32 bytes each
+const int RADIANCE_CACHE_MIN_BOUNCE = 3;                 // Bounce from which paths may end in the cache
+const float RADIANCE_CACHE_MAX_GLOSSINESS = 0.2f;        // Smoothness * specular chance of surfaces using the cache
+const float RADIANCE_CACHE_CELL_SIZE = 0.25f;            // Bias control: larger cells converge faster but blur more
+const float RADIANCE_CACHE_REFERENCE_DISTANCE = 10.0f;   // Cells double in size each time the camera distance doubles past this
+const int RADIANCE_CACHE_MIN_SAMPLES = 16;               // Bias control: samples a cell needs before it is used
+const int RADIANCE_CACHE_MAX_SAMPLES = 4096;             // Converged cells stop updating
+
+// Ray cone texture LOD: paths carry the cone of their pixel footprint and sample the model
+// textures at the matching mip, so distant surfaces and later bounces read the small mips
+const bool RAY_CONE_TEXTURE_LOD = true;
+const float RAY_CONE_ROUGH_SPREAD = 0.25f;    // Radians a diffuse bounce adds to the cone; larger blurs textures seen indirectly
+
+// Progressive photon mapping
+const int PPM_PHOTONS = 1 << 17;              // Photons emitted per frame
+const int PPM_PHOTON_BOUNCES = 6;             // Surface interactions per photon path
+const int PPM_GRID_CELLS = 1 << 18;           // Hash grid cells
+const float PPM_INITIAL_RADIUS = 1.0f;        // Gather radius of the first frame, in world units
+const float PPM_ALPHA = 2.0f / 3.0f;          // Radius reduction, r^2 shrinks by (i + alpha) / (i + 1)
+
+// HDR environment map, replaces the procedural sky when it loads (scaled by SKYSTRENGTH).
+// Off by default as no map ships with the repo; put one at ENVIRONMENT_MAP_PATH to use it.
+const bool ENVIRONMENT_MAP = false;
+const char* ENVIRONMENT_MAP_PATH = "models/environment.hdr";   // Equirectangular .hdr, its CDF is cached as <path>.cdf
+
+// Histogram auto-exposure, default.frag scales the HDR accumulation by it before ACES
+const bool AUTO_EXPOSURE = true;
+const float EXPOSURE_KEY = 0.18f;              // Luminance the trimmed average is mapped to
+const float EXPOSURE_ADAPTATION = 0.05f;       // Fraction of the new average blended in per frame
+const float EXPOSURE_LOW_PERCENTILE = 0.5f;    // Pixels below/above these percentiles don't affect the average
+const float EXPOSURE_HIGH_PERCENTILE = 0.95f;
+
+// Chrome / Perfetto trace of the profiled frames, written on exit (nullptr skips it)
+const char* PROFILE_TRACE_PATH = "profile_trace.json";
+
+// Slots of the GpuReduction result buffer
+enum ReductionSlot {
+    REDUCTION_SLOT_MLT_NORMALIZATION = 0,
+    REDUCTION_SLOT_EXPOSURE = 1
+};
+
+// Passes of the PSSMLT mode, must match MLT_PASS_* in compute.comp
+enum MLTPass {
+    MLT_PASS_BOOTSTRAP = 0,
+    MLT_PASS_SCAN = 1,
+    MLT_PASS_INIT_CHAINS = 2,
+    MLT_PASS_MUTATE = 3,
+    MLT_PASS_RESOLVE = 4
+};
+
+// Passes of the photon mapping mode, must match PPM_PASS_* in compute.comp
+enum PPMPass {
+    PPM_PASS_TRACE = 0,
+    PPM_PASS_COUNT = 1,
+    PPM_PASS_SCAN = 2,
+    PPM_PASS_SCATTER = 3,
+    PPM_PASS_GATHER = 4
+};
+
 bool wasPressed = false;
 
 // Render mode enumeration
 enum RenderMode {
     PATH_TRACING = 0,
     METROPLIS = 1,
-    PATH_TRACING_BIDIRECTIONAL = 2
+    PATH_TRACING_BIDIRECTIONAL = 2,
+    NEXT_EVENT_ESTIMATION = 3,
+    PSS_METROPLIS = 4,
+    PATH_TRACING_BIDIRECTIONAL_LVC = 5,
+    RESTIR_DI = 6,
+    RESTIR_GI = 7,
+    PROGRESSIVE_PHOTON_MAPPING = 8,
+    LIGHT_TRACING = 9,
+    WAVEFRONT_PATH_TRACING = 10
 };
 
 enum ScenePreset {
@@ -50,48 +176,71 @@ enum ScenePreset {
 const RenderMode renderMode = PATH_TRACING;
 const ScenePreset preset = IndoorDiffuse;
 
+// Texture unit ASSIMP binds the model texture array to
+const int MODEL_TEXTURE_UNIT = 6;
+
+// Path tracing takes the mesh hits of its camera rays from a rasterized visibility buffer instead
+// of traversing the BVH; the buffer is rendered again only when the camera moves
+const bool HYBRID_PRIMARY_HITS = true;
+
+// Compile the scene's features (translucency, textures, spheres, bounces, BVH depth) into
+// compute.comp, so code the scene never reaches is left out. The render mode is always injected.
+const bool SPECIALIZE_SHADERS = true;
+
+// Bytes of per-frame data each ring buffer slot can hold
+const int FRAME_RING_SLOT_SIZE = 4096;
+
 // Define workgroup and dispatch sizes
 const int LAYOUT_SIZE_X = 8;
 const int LAYOUT_SIZE_Y = 8;
+
+// The single-pass modes (path tracing, bidirectional, NEE) time these workgroup sizes at startup
+// and keep the fastest. The result is cached per GPU and scene; --retune-workgroups forces a rerun.
+const bool AUTOTUNE_WORKGROUPS = true;
+const WorkgroupTuner::Size WORKGROUP_CANDIDATES[] = { {8, 8}, {16, 8}, {8, 16}, {16, 16}, {32, 4}, {32, 8} };
 const int METROPLIS_DISPATCH_X = 16;
 const int METROPLIS_DISPATCH_Y = 16;
 
 // Start time for FPS calculation
 static auto startTime = std::chrono::steady_clock::now();
+
+// Uploads data to a new SSBO at binding; the buffer is freed in OnWindowClose
+template <class T>
+GLuint RayScene::StoreSceneBuffer(const T& data, int binding) {
+    GLuint buffer = computeShader.StoreSSBO(data, binding, false);
+    sceneBuffers.push_back(buffer);
+    return buffer;
+}
 //
 // RayScene class constructor and methods
 //
-RayScene::RayScene(Window& win) :
+RayScene::RayScene(Window& win, bool retuneWorkgroups) :
     SCREEN_WIDTH(win.width),
     SCREEN_HEIGHT(win.height),
     shader("shaders/default.vert", "shaders/default.frag"),
-    computeShader("shaders/compute.comp"),
     copyAccumShader("shaders/accumulation.comp"),
-    tex(SCREEN_WIDTH, SCREEN_HEIGHT, 0, 0),
-    biasTex(SCREEN_WIDTH, SCREEN_HEIGHT, 1, 1),
-    oldTex(SCREEN_WIDTH, SCREEN_HEIGHT, 2, 2),
-    metroplisColorsTex(SCREEN_WIDTH, SCREEN_HEIGHT, 5, 5),
-    metroplisDirectionsTex(SCREEN_WIDTH, SCREEN_HEIGHT, 6, 6),
-    camera(SCREEN_WIDTH, SCREEN_HEIGHT, glm::vec3(0.0f, 0.0f, -5.0f)),
     textShader("shaders/text_vertex.vert", "shaders/text_fragment.frag"),
-    text(SCREEN_WIDTH, SCREEN_HEIGHT, "fonts/Raleway-Black.ttf")
+    camera(SCREEN_WIDTH, SCREEN_HEIGHT, glm::vec3(0.0f, 0.0f, -5.0f)),
+    text(SCREEN_WIDTH, SCREEN_HEIGHT, "fonts/Raleway-Black.ttf"),
+    layoutSizeX(LAYOUT_SIZE_X),
+    layoutSizeY(LAYOUT_SIZE_Y)
 {
-    // Setup shader storage buffer for per-thread BVH stack
-    const int MAX_STACK_SIZE = 32;
-    const int dispatchX = SCREEN_WIDTH / (renderMode == METROPLIS ? METROPLIS_DISPATCH_X : LAYOUT_SIZE_X);
-    const int dispatchY = SCREEN_HEIGHT / (renderMode == METROPLIS ? METROPLIS_DISPATCH_Y : LAYOUT_SIZE_Y);
-    const int localSizeX = 16;  // Must match shader's local_size_x
-    const int localSizeY = 16;  // Must match shader's local_size_y
-
-    int totalThreads = dispatchX * dispatchY * localSizeX * localSizeY;
-    int bufferSize = MAX_STACK_SIZE * totalThreads * sizeof(int);
+    // Screen and history swap roles every frame; the modes that resolve the whole screen at once
+    // never read the history, so they get a single target. Only Metropolis needs its images.
+    const bool accumulates = renderMode != METROPLIS && renderMode != PSS_METROPLIS && renderMode != LIGHT_TRACING;
+    accumulationTargets[0] = std::make_unique<Texture>(SCREEN_WIDTH, SCREEN_HEIGHT, 0, 0, GL_READ_WRITE, ACCUMULATION_FORMAT);
+    if (accumulates)
+        accumulationTargets[1] = std::make_unique<Texture>(SCREEN_WIDTH, SCREEN_HEIGHT, 2, 2, GL_READ_WRITE, ACCUMULATION_FORMAT);
+    if (renderMode == METROPLIS) {
+        biasTex = std::make_unique<Texture>(1, 1, 1, 1, GL_READ_WRITE, GL_R32F);
+        metroplisColorsTex = std::make_unique<Texture>(SCREEN_WIDTH, SCREEN_HEIGHT, 5, 5, GL_READ_WRITE, METROPOLIS_SAMPLE_FORMAT);
+        metroplisDirectionsTex = std::make_unique<Texture>(SCREEN_WIDTH, SCREEN_HEIGHT, 6, 6, GL_READ_WRITE, METROPOLIS_DIRECTION_FORMAT);
+    }
 
-    GLuint bvhStackBuffer;
-    glGenBuffers(1, &bvhStackBuffer);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, bvhStackBuffer);
-    glBufferData(GL_SHADER_STORAGE_BUFFER, bufferSize, nullptr, GL_DYNAMIC_COPY);
-    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 20, bvhStackBuffer);
-    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    // First-hit positions for temporal reprojection: two frames, one vec4 per pixel.
+    // w = -1 marks an entry that has not been written yet.
+    std::vector<glm::vec4> firstHitData(2 * SCREEN_WIDTH * SCREEN_HEIGHT, glm::vec4(0.0f, 0.0f, 0.0f, -1.0f));
+    firstHitBuffer = StoreSceneBuffer(firstHitData, 25);
 
 
     std::vector<Triangle> tris;
@@ -227,39 +376,429 @@ RayScene::RayScene(Window& win) :
 
 
     AddMeshes();
-    AddSurfaces();
+    std::vector<TraceCircle> circles = AddSurfaces();
+
+    // Built once the scene is known; every variant compiles once thanks to the program cache
+    sceneDefines = SceneDefines(circles);
+    const bool tunable = renderMode == PATH_TRACING || renderMode == PATH_TRACING_BIDIRECTIONAL ||
+        renderMode == NEXT_EVENT_ESTIMATION;
+    WorkgroupTuner tuner(SceneHash());
+    WorkgroupTuner::Size tuned;
+    const bool tuneWorkgroups = AUTOTUNE_WORKGROUPS && tunable && (retuneWorkgroups || !tuner.Load(tuned));
+    if (AUTOTUNE_WORKGROUPS && tunable && !tuneWorkgroups) {
+        layoutSizeX = tuned.x;
+        layoutSizeY = tuned.y;
+    }
+    computeShader = Shader("shaders/compute.comp", ComputeDefines(layoutSizeX, layoutSizeY));
+
+    // Rendered before any tuning frame so those time the hybrid primary hits as well
+    if (HYBRID_PRIMARY_HITS && renderMode == PATH_TRACING) {
+        std::vector<int> modelTriangleOffsets;
+        for (const BVHModel& model : sceneBVH.Models)
+            modelTriangleOffsets.push_back(model.TriangleOffset);
+        modelTriangleOffsets.push_back(static_cast<int>(sceneBVH.Triangles.size()));
+        visibilityBuffer = std::make_unique<VisibilityBuffer>(SCREEN_WIDTH, SCREEN_HEIGHT, modelTriangleOffsets);
+        visibilityBuffer->Render(CurrentCameraSettings());
+    }
 
-    if (renderMode == PATH_TRACING_BIDIRECTIONAL) {
+    // Thread count of one dispatch, used to size the per-thread path buffers. While tuning, the
+    // candidates share the buffers, so they are sized for the largest workgroup.
+    int tileX = layoutSizeX, tileY = layoutSizeY;
+    if (tuneWorkgroups) {
+        for (const WorkgroupTuner::Size& size : WORKGROUP_CANDIDATES) {
+            tileX = std::max(tileX, size.x);
+            tileY = std::max(tileY, size.y);
+        }
+    }
+    const int dispatchX = renderMode == METROPLIS ? SCREEN_WIDTH / METROPLIS_DISPATCH_X : (SCREEN_WIDTH + tileX - 1) / tileX;
+    const int dispatchY = renderMode == METROPLIS ? SCREEN_HEIGHT / METROPLIS_DISPATCH_Y : (SCREEN_HEIGHT + tileY - 1) / tileY;
+    int totalThreads = dispatchX * dispatchY * tileX * tileY;
+
+    // The Metropolis burn-in traces bidirectional paths as well
+    if (renderMode == PATH_TRACING_BIDIRECTIONAL || renderMode == METROPLIS) {
 
         // Define constants for path tracing
-        const int MAX_PATH_LENGTH = BIDIRECTIONALMAXPATHS;  // Must match your shader definition
+        const int MAX_PATH_LENGTH = BIDIRECTIONALMAXPATHS;  // Must match MAX_PATH_LENGTH in the shader
 
-        // Create properly sized vertex buffers for paths
-        // Define a dummy Vertex aligned with your shader's Vertex structure
+        // Light subpath vertex, aligned with the shader's Vertex structure.
+        // Camera subpaths are connected while they are traced and aren't stored.
         struct ShaderVertex {
-            glm::vec3 position;       // 12 bytes
-            int objIndex;
-            glm::vec3 normal;         // 12 bytes
-            int objType;
-            glm::vec3 throughput;     // 12 bytes
-            float PDF;                // 4 bytes
-            glm::vec3 emmision;
+            glm::vec3 position;
+            float dVCM;
+            glm::vec3 normal;
+            float dVC;
+            glm::vec3 throughput;
+            float cosIn;
+            glm::vec3 diffuse;
+            float diffusePdfScale;
         };
 
         // Calculate total needed size
         size_t vertexBufferSize = sizeof(ShaderVertex) * MAX_PATH_LENGTH * totalThreads;
 
-        // Create the camera path buffer using your existing Shader class methods
-        // We create empty buffers sized appropriately for the data
-        std::vector<unsigned char> cameraPathData(vertexBufferSize, 0);
-        computeShader.StoreSSBO(cameraPathData, 21, false);
-
         // Create the light path buffer
         std::vector<unsigned char> lightPathData(vertexBufferSize, 0);
-        computeShader.StoreSSBO(lightPathData, 22, false);
+        StoreSceneBuffer(lightPathData, 22);
+    }
+
+    if (renderMode == PATH_TRACING_BIDIRECTIONAL_LVC) {
+        // Header (vertex count, capacity, padding) followed by 64 byte cache vertices.
+        // Every light subpath stores at most one vertex per bounce.
+        const GLuint capacity = LVC_LIGHT_PATHS * LIGHTSUBPATHS;
+        std::vector<GLuint> cacheData(4 + capacity * 16, 0);
+        cacheData[1] = capacity;
+        lightVertexCacheBuffer = StoreSceneBuffer(cacheData, 22);
+    }
+
+    if (renderMode == RESTIR_DI) {
+        // Two 96 byte reservoirs per pixel: after temporal reuse, and final (next frame's history)
+        const size_t reservoirSize = 96;
+        std::vector<unsigned char> reservoirData(2 * reservoirSize * SCREEN_WIDTH * SCREEN_HEIGHT, 0);
+        StoreSceneBuffer(reservoirData, 26);
+    }
+
+    if (renderMode == RESTIR_GI) {
+        // Same layout as the DI reservoirs, 96 bytes each
+        const size_t reservoirSize = 96;
+        std::vector<unsigned char> reservoirData(2 * reservoirSize * SCREEN_WIDTH * SCREEN_HEIGHT, 0);
+        StoreSceneBuffer(reservoirData, 27);
+    }
+
+    if (renderMode == PATH_TRACING && PATH_GUIDING) {
+        // The spatial tree splits the bounds of the scene geometry, padded slightly
+        BoundingBox bounds;
+        for (const Triangle& triangle : sceneBVH.Triangles)
+            bounds.GrowToInclude(triangle);
+        glm::vec3 padding = 0.01f * (bounds.Max - bounds.Min) + glm::vec3(1e-3f);
+
+        pathGuiding = std::make_unique<PathGuiding>(bounds.Min - padding, bounds.Max + padding,
+            GUIDING_TRAINING_ITERATIONS, GUIDING_SPATIAL_THRESHOLD, GUIDING_ENERGY_THRESHOLD);
+    }
+
+    if (renderMode == PATH_TRACING) {
+        // {key, samples, r, g, b, padding} per slot; a single slot keeps the binding valid when disabled
+        std::vector<GLuint> cacheData(8 * (RADIANCE_CACHE ? RADIANCE_CACHE_ENTRIES : 1), 0);
+        StoreSceneBuffer(cacheData, 33);
+    }
+
+    if (renderMode == PROGRESSIVE_PHOTON_MAPPING) {
+        // Header (photon count, capacity, padding) followed by 48 byte photons
+        const GLuint capacity = PPM_PHOTONS * PPM_PHOTON_BOUNCES;
+        std::vector<GLuint> photonData(4 + capacity * 12, 0);
+        photonData[1] = capacity;
+        photonBuffer = StoreSceneBuffer(photonData, 34);
+
+        // {start, count} per cell, then the photon indices sorted by cell
+        std::vector<GLuint> gridData(2 * PPM_GRID_CELLS, 0);
+        photonGridBuffer = StoreSceneBuffer(gridData, 35);
+        std::vector<GLuint> indexData(capacity, 0);
+        StoreSceneBuffer(indexData, 36);
+
+        ResetPhotonMapping();
+    }
+
+    reduction = std::make_unique<GpuReduction>();
+    profiler = std::make_unique<Profiler>();
+
+    // Per-frame data: Frame, camera and the FrameConstants block, all far below the slot size
+    frameRing = std::make_unique<RingBuffer>(FRAME_RING_SLOT_SIZE);
+    frameConstants = std::make_unique<UniformBlock>(computeShader, "FrameConstants");
+
+    if (PERSISTENT_THREADS) {
+        GLuint zero = 0;
+        glCreateBuffers(1, &persistentCounterBuffer);
+        glNamedBufferData(persistentCounterBuffer, sizeof(GLuint), &zero, GL_DYNAMIC_COPY);
+        persistentWorkgroups = PersistentWorkgroupCount();
+    }
+
+    if (renderMode == WAVEFRONT_PATH_TRACING)
+        wavefront = std::make_unique<WavefrontPipeline>(SCREEN_WIDTH * SCREEN_HEIGHT, ComputeDefines(layoutSizeX, layoutSizeY));
+
+    if (ENVIRONMENT_MAP) {
+        environmentMap = std::make_unique<EnvironmentMap>();
+        if (!environmentMap->Load(ENVIRONMENT_MAP_PATH)) {
+            std::cerr << "Falling back to the procedural sky\n";
+            environmentMap.reset();
+        }
+    }
+
+    if (renderMode == METROPLIS || renderMode == PSS_METROPLIS || renderMode == LIGHT_TRACING) {
+        // RGB fixed-point splat counters per pixel
+        std::vector<GLuint> splats(3 * SCREEN_WIDTH * SCREEN_HEIGHT, 0);
+        splatBuffer = StoreSceneBuffer(splats, 29);
+    }
+
+    if (renderMode == PSS_METROPLIS) {
+        // Chain states are fully written by the init pass
+        std::vector<MLTChain> chains(MLT_CHAINS);
+        StoreSceneBuffer(chains, 28);
+
+        // 16 byte header (b, total, padding) followed by {cdf, seed} pairs
+        std::vector<unsigned char> bootstrap(16 + 8 * MLT_BOOTSTRAP_SAMPLES, 0);
+        StoreSceneBuffer(bootstrap, 30);
+    }
+
+    if (tuneWorkgroups)
+        AutotuneWorkgroupSize(tuner);
+}
+
+//
+// AutotuneWorkgroupSize() – Builds compute.comp for every candidate workgroup size, renders a few
+// frames with each and keeps the fastest. Variants that fail to link, e.g. because their BVH stack
+// exceeds the shared memory, are skipped. The tuning frames only leave valid samples behind, and
+// accumulation restarts from the first real frame since Frame stays 0.
+//
+void RayScene::AutotuneWorkgroupSize(const WorkgroupTuner& tuner) {
+    GLint maxInvocations = 0;
+    glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &maxInvocations);
+
+    // The program built with the default size is reused for that candidate and kept as the fallback
+    Shader initialShader = computeShader;
+    WorkgroupTuner::Size best = { layoutSizeX, layoutSizeY };
+    Shader bestShader = initialShader;
+    double bestMilliseconds = std::numeric_limits<double>::infinity();
+
+    for (const WorkgroupTuner::Size& size : WORKGROUP_CANDIDATES) {
+        if (size.x * size.y > maxInvocations)
+            continue;
+
+        bool isInitial = size.x == LAYOUT_SIZE_X && size.y == LAYOUT_SIZE_Y;
+        Shader candidate = isInitial ? initialShader : Shader("shaders/compute.comp", ComputeDefines(size.x, size.y));
+        if (!candidate.Linked()) {
+            if (!isInitial)
+                candidate.Delete();
+            continue;
+        }
+
+        computeShader = candidate;
+        layoutSizeX = size.x;
+        layoutSizeY = size.y;
+        persistentWorkgroups = PersistentWorkgroupCount();
+        double milliseconds = WorkgroupTuner::Time([this]() { TuningFrame(); });
+        std::cout << "Workgroup " << size.x << "x" << size.y << ": " << std::fixed << std::setprecision(2)
+            << milliseconds << " ms" << std::endl;
+
+        Shader& loser = milliseconds < bestMilliseconds ? bestShader : candidate;
+        if (loser.ID != initialShader.ID)
+            loser.Delete();
+        if (milliseconds < bestMilliseconds) {
+            best = size;
+            bestShader = candidate;
+            bestMilliseconds = milliseconds;
+        }
+    }
+
+    if (bestShader.ID != initialShader.ID)
+        initialShader.Delete();
+    computeShader = bestShader;
+    layoutSizeX = best.x;
+    layoutSizeY = best.y;
+    persistentWorkgroups = PersistentWorkgroupCount();
+    tuner.Save(best);
+    std::cout << "Workgroup size: " << best.x << "x" << best.y << std::endl;
+}
+
+// One frame as OnBufferSwap dispatches it, without input, display or accumulation bookkeeping
+void RayScene::TuningFrame() {
+    camera.UpdateMatrix(45.0f, 0.1f, 100.0f);
+    CameraSettings cameraSettings = CurrentCameraSettings();
+
+    frameRing->BeginFrame();
+    frameRing->Write(GL_SHADER_STORAGE_BUFFER, 4, &Frame, sizeof(Frame));
+    frameRing->Write(GL_SHADER_STORAGE_BUFFER, 3, &cameraSettings, sizeof(cameraSettings));
+    SetFrameUniforms(0.0, false, false);
+    BindFrameTextures(computeShader);
+    glMemoryBarrier(GL_ALL_BARRIER_BITS);
+    DispatchScreen(ScreenGroupsX(), ScreenGroupsY());
+    glMemoryBarrier(GL_ALL_BARRIER_BITS);
+    frameRing->EndFrame();
+}
+
+// Rebinds the targets instead of copying the screen into the history, which cost a full-screen
+// copy per frame. Single-target modes keep writing the same image.
+void RayScene::SwapAccumulationTargets() {
+    if (!accumulationTargets[1])
+        return;
+    accumulationTarget = 1 - accumulationTarget;
+    accumulationTargets[accumulationTarget]->BindImage(0);
+    accumulationTargets[1 - accumulationTarget]->BindImage(2);
+}
+
+// Workgroups covering the screen; partial tiles at the right and bottom edges are included
+int RayScene::ScreenGroupsX() const {
+    return (SCREEN_WIDTH + layoutSizeX - 1) / layoutSizeX;
+}
+
+int RayScene::ScreenGroupsY() const {
+    return (SCREEN_HEIGHT + layoutSizeY - 1) / layoutSizeY;
+}
+
+//
+// PersistentWorkgroupCount() – Workgroups that fit on the GPU at once. NVIDIA reports its SM count
+// and resident warps per SM through GL_NV_shader_thread_group; other drivers get PERSISTENT_WORKGROUPS.
+//
+int RayScene::PersistentWorkgroupCount() const {
+    const GLenum GL_WARPS_PER_SM = 0x933A;    // GL_WARPS_PER_SM_NV
+    const GLenum GL_SM_COUNT = 0x933B;        // GL_SM_COUNT_NV
+
+    GLint extensionCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+    for (GLint i = 0; i < extensionCount; i++) {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (!extension || std::string(extension) != "GL_NV_shader_thread_group")
+            continue;
+
+        GLint smCount = 0, warpsPerSM = 0;
+        glGetIntegerv(GL_SM_COUNT, &smCount);
+        glGetIntegerv(GL_WARPS_PER_SM, &warpsPerSM);
+        const int warpsPerGroup = (layoutSizeX * layoutSizeY + 31) / 32;
+        if (smCount > 0 && warpsPerSM > 0)
+            return std::max(smCount * warpsPerSM / warpsPerGroup, 1);
+    }
+    return PERSISTENT_WORKGROUPS;
+}
+
+//
+// DispatchScreen() – Runs the current pass once per pixel. With PERSISTENT_THREADS the workgroups
+// stay resident and pull tiles from the counter, so groups whose paths end early take more tiles
+// instead of idling; otherwise it is a plain gX x gY dispatch.
+//
+void RayScene::DispatchScreen(int gX, int gY) {
+    if (!PERSISTENT_THREADS) {
+        computeShader.Dispatch(gX, gY, 1);
+        return;
+    }
+
+    glClearNamedBufferData(persistentCounterBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBufferBase(GL_ATOMIC_COUNTER_BUFFER, 0, persistentCounterBuffer);
+
+    computeShader.SetParameterInt(1, "PersistentThreads");
+    computeShader.Dispatch(std::min(persistentWorkgroups, gX * gY), 1, 1);
+    computeShader.SetParameterInt(0, "PersistentThreads");
+}
+
+//
+// DispatchLightVertexCache() – Refills the light vertex cache with fresh light subpaths,
+// then traces the camera subpaths that connect to it.
+//
+void RayScene::DispatchLightVertexCache(int gX, int gY) {
+    const int groupSize = layoutSizeX * layoutSizeY;
+
+    // Reset the append counter; the capacity behind it stays untouched
+    glClearNamedBufferSubData(lightVertexCacheBuffer, GL_R32UI, 0, sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+    computeShader.SetParameterInt(0, "LVCPass");
+    computeShader.Dispatch((LVC_LIGHT_PATHS + groupSize - 1) / groupSize, 1, 1);
+
+    computeShader.SetParameterInt(1, "LVCPass");
+    DispatchScreen(gX, gY);
+}
+
+//
+// DispatchReSTIR() – Used by both ReSTIR modes. Generates candidates and reuses last frame's reservoirs, then merges
+// neighbouring reservoirs and shades. The spatial pass feeds the accumulation as usual.
+//
+void RayScene::DispatchReSTIR(int gX, int gY) {
+    computeShader.SetParameterInt(0, "ReSTIRPass");
+    DispatchScreen(gX, gY);
+
+    computeShader.SetParameterInt(1, "ReSTIRPass");
+    DispatchScreen(gX, gY);
+}
+
+//
+// DispatchPhotonMapping() – Traces a fresh photon map, sorts it into the hash grid and gathers
+// it from the camera, then shrinks the radius for the next frame.
+//
+void RayScene::DispatchPhotonMapping(int gX, int gY) {
+    const int groupSize = layoutSizeX * layoutSizeY;
+    const int photonGroups = (PPM_PHOTONS * PPM_PHOTON_BOUNCES + groupSize - 1) / groupSize;
+
+    glClearNamedBufferSubData(photonBuffer, GL_R32UI, 0, sizeof(GLuint), GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glClearNamedBufferData(photonGridBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+
+    computeShader.SetParameterFloat(ppmRadius, "PPMRadius");
+
+    computeShader.SetParameterInt(PPM_PASS_TRACE, "PPMPass");
+    computeShader.Dispatch((PPM_PHOTONS + groupSize - 1) / groupSize, 1, 1);
 
+    computeShader.SetParameterInt(PPM_PASS_COUNT, "PPMPass");
+    computeShader.Dispatch(photonGroups, 1, 1);
 
+    computeShader.SetParameterInt(PPM_PASS_SCAN, "PPMPass");
+    computeShader.Dispatch(1, 1, 1);
+
+    computeShader.SetParameterInt(PPM_PASS_SCATTER, "PPMPass");
+    computeShader.Dispatch(photonGroups, 1, 1);
+
+    computeShader.SetParameterInt(PPM_PASS_GATHER, "PPMPass");
+    DispatchScreen(gX, gY);
+
+    ppmIteration++;
+    ppmRadius *= std::sqrt((ppmIteration + PPM_ALPHA) / (ppmIteration + 1.0f));
+}
+
+//
+// ResetPhotonMapping() – Restarts the radius progression, called whenever the camera moves.
+// The radius is shared by all pixels, so pixels whose history is rejected could not start from
+// PPM_INITIAL_RADIUS otherwise. Reprojected pixels then blend a few wider, blurrier gathers into
+// their history; those frames are weighted like any other and fade out as the radius shrinks again.
+//
+void RayScene::ResetPhotonMapping() {
+    ppmRadius = PPM_INITIAL_RADIUS;
+    ppmIteration = 0;
+}
+
+//
+// DispatchPrimarySampleMetropolis() – Runs the PSSMLT passes for one frame. The bootstrap,
+// scan and chain initialisation only run when accumulation restarts.
+//
+void RayScene::DispatchPrimarySampleMetropolis(bool bootstrap) {
+    const int groupSize = layoutSizeX * layoutSizeY;
+
+    if (bootstrap) {
+        mltSeed++;
+        computeShader.SetParameterInt(mltSeed, "MLTSeed");
+
+        computeShader.SetParameterInt(MLT_PASS_BOOTSTRAP, "MLTPass");
+        computeShader.Dispatch((MLT_BOOTSTRAP_SAMPLES + groupSize - 1) / groupSize, 1, 1);
+
+        computeShader.SetParameterInt(MLT_PASS_SCAN, "MLTPass");
+        computeShader.Dispatch(1, 1, 1);
+
+        computeShader.SetParameterInt(MLT_PASS_INIT_CHAINS, "MLTPass");
+        computeShader.Dispatch((MLT_CHAINS + groupSize - 1) / groupSize, 1, 1);
     }
+
+    computeShader.SetParameterInt(MLT_PASS_MUTATE, "MLTPass");
+    computeShader.Dispatch((MLT_CHAINS + groupSize - 1) / groupSize, 1, 1);
+
+    computeShader.SetParameterInt(MLT_PASS_RESOLVE, "MLTPass");
+    computeShader.Dispatch(ScreenGroupsX(), ScreenGroupsY(), 1);
+}
+
+//
+// DispatchLightTracing() – Traces the light paths, which splat their camera connections,
+// then resolves the splat buffer into the screen.
+//
+void RayScene::DispatchLightTracing() {
+    const int groupSize = layoutSizeX * layoutSizeY;
+
+    computeShader.SetParameterInt(0, "SplatResolve");
+    computeShader.Dispatch((LIGHT_TRACING_PATHS + groupSize - 1) / groupSize, 1, 1);
+
+    DispatchSplatResolve();
+}
+
+//
+// DispatchSplatResolve() – Writes the accumulated splats of the Metropolis or light tracing
+// mode to the screen, one thread per pixel.
+//
+void RayScene::DispatchSplatResolve() {
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    computeShader.SetParameterInt(1, "SplatResolve");
+    computeShader.Dispatch(ScreenGroupsX(), ScreenGroupsY(), 1);
+    computeShader.SetParameterInt(0, "SplatResolve");
 }
 
 
@@ -349,7 +888,7 @@ void RayScene::SetupEmissiveObjectsBuffer(const std::vector<TraceCircle> circles
 
     // Create emissive objects buffer
     if (!emissiveObjects.empty()) {
-        computeShader.StoreSSBO<EmissiveObjectData>(emissiveObjects, 23, false);
+        StoreSceneBuffer(emissiveObjects, 23);
 
         // Create power info buffer
         EmissivePowerInfo powerInfo;
@@ -357,7 +896,7 @@ void RayScene::SetupEmissiveObjectsBuffer(const std::vector<TraceCircle> circles
         powerInfo.numEmissiveObjects = static_cast<int>(emissiveObjects.size());
         powerInfo.padding = glm::vec2(0.0f);
 
-        computeShader.StoreSSBO<EmissivePowerInfo>(powerInfo, 24, false);
+        StoreSceneBuffer(powerInfo, 24);
 
         std::cout << "Created emissive objects buffer with " << emissiveObjects.size()
             << " objects, total power: " << totalPower << std::endl;
@@ -365,11 +904,11 @@ void RayScene::SetupEmissiveObjectsBuffer(const std::vector<TraceCircle> circles
     else {
         // Create empty buffers with zero objects
         EmissivePowerInfo powerInfo = { 0.0f, 0, glm::vec2(0.0f) };
-        computeShader.StoreSSBO<EmissivePowerInfo>(powerInfo, 24, false);
+        StoreSceneBuffer(powerInfo, 24);
 
         // Create a dummy empty buffer for emissive objects
         std::vector<EmissiveObjectData> dummyBuffer(1); // One empty entry
-        computeShader.StoreSSBO<EmissiveObjectData>(dummyBuffer, 23, false);
+        StoreSceneBuffer(dummyBuffer, 23);
 
         std::cout << "No emissive objects found in scene" << std::endl;
     }
@@ -393,22 +932,22 @@ void updateFPS() {
 void RayScene::AddMeshes() {
     // Upload triangle data.
    // (Assuming sceneBVH.Triangles is of type BVHTriangle or compatible with Triangle)
-    computeShader.StoreSSBO<Triangle>(sceneBVH.Triangles, 9, false);
+    StoreSceneBuffer(sceneBVH.Triangles, 9);
     // (If you no longer need to upload a separate triangle count, omit it.)
 
     // Upload BVH node array to binding 11 and its count to binding 12.
-    computeShader.StoreSSBO<BVHNode>(sceneBVH.FlatNodes, 11, false);
-    computeShader.StoreSSBO<GLuint>(static_cast<GLuint>(sceneBVH.FlatNodes.size()), 12, false);
+    StoreSceneBuffer(sceneBVH.FlatNodes, 11);
+    StoreSceneBuffer(static_cast<GLuint>(sceneBVH.FlatNodes.size()), 12);
     // Upload model array to binding 13 and its count to binding 14.
-    computeShader.StoreSSBO<BVHModel>(sceneBVH.Models, 13, false);
-    computeShader.StoreSSBO<GLuint>(static_cast<GLuint>(sceneBVH.Models.size()), 14, false);
+    StoreSceneBuffer(sceneBVH.Models, 13);
+    StoreSceneBuffer(static_cast<GLuint>(sceneBVH.Models.size()), 14);
 }
 
 //
 // Updated AddSurfaces() – the circles (spheres) and boxes are now uploaded
 // to the new bindings (5–6 for circles; 7–8 for boxes)
 //
-void RayScene::AddSurfaces() {
+std::vector<TraceCircle> RayScene::AddSurfaces() {
     std::vector<TraceCircle> circles;
 
     TraceCircle circle2;
@@ -471,10 +1010,98 @@ void RayScene::AddSurfaces() {
 
 
     // Upload circles to binding 5 and their count to binding 6.
-    computeShader.StoreSSBO<TraceCircle>(circles, 7, false);
-    computeShader.StoreSSBO<GLuint>(static_cast<GLuint>(circles.size()), 8, false);
+    StoreSceneBuffer(circles, 7);
+    StoreSceneBuffer(static_cast<GLuint>(circles.size()), 8);
 
     SetupEmissiveObjectsBuffer(circles);
+    return circles;
+}
+
+// Nodes on the longest root-to-leaf path below nodeIndex, child indices being absolute
+static int BVHDepth(const std::vector<BVHNode>& nodes, int nodeIndex) {
+    const BVHNode& node = nodes[nodeIndex];
+    if (node.isLeaf())
+        return 1;
+    return 1 + std::max(BVHDepth(nodes, node.ChildIndex), BVHDepth(nodes, node.ChildIndex + 1));
+}
+
+// GLSL layout qualifier of the render target formats RayScene allocates
+static const char* ImageFormatQualifier(GLenum format) {
+    switch (format) {
+    case GL_RGBA16F: return "rgba16f";
+    case GL_RG32F: return "rg32f";
+    case GL_RG16F: return "rg16f";
+    case GL_R32F: return "r32f";
+    default: return "rgba32f";
+    }
+}
+
+//
+// SceneDefines() – Looks at the uploaded scene and turns off the shader features it never
+// uses. The traversal pushes both children of a node and pops one, so a BVH with N levels
+// needs a stack of N entries.
+//
+std::vector<std::string> RayScene::SceneDefines(const std::vector<TraceCircle>& circles) const {
+    std::vector<std::string> defines = { "RENDER_MODE_" + std::to_string(renderMode) };
+
+    // The image declarations must match the formats the targets were allocated with
+    defines.push_back(std::string("ACCUMULATION_IMAGE_FORMAT ") + ImageFormatQualifier(ACCUMULATION_FORMAT));
+    defines.push_back(std::string("METROPOLIS_SAMPLE_IMAGE_FORMAT ") + ImageFormatQualifier(METROPOLIS_SAMPLE_FORMAT));
+    defines.push_back(std::string("METROPOLIS_DIRECTION_IMAGE_FORMAT ") + ImageFormatQualifier(METROPOLIS_DIRECTION_FORMAT));
+    if (HYBRID_PRIMARY_HITS && renderMode == PATH_TRACING)
+        defines.push_back("HYBRID_PRIMARY_HITS");
+    if (!SPECIALIZE_SHADERS)
+        return defines;
+
+    bool translucent = false;
+    bool textures = false;
+    int stackSize = 1;
+    for (const BVHModel& model : sceneBVH.Models) {
+        translucent |= model.material.isTranslucent == 1;
+        textures |= model.material.textureSlot != static_cast<GLuint>(-1);  // -1: untextured
+        stackSize = std::max(stackSize, BVHDepth(sceneBVH.FlatNodes, model.NodeOffset));
+    }
+    for (const TraceCircle& circle : circles)
+        translucent |= circle.material.isTranslucent == 1;
+
+    defines.push_back("SCENE_TRANSLUCENT " + std::to_string(translucent ? 1 : 0));
+    defines.push_back("SCENE_TEXTURES " + std::to_string(textures ? 1 : 0));
+    defines.push_back("SCENE_SPHERES " + std::to_string(circles.empty() ? 0 : 1));
+    defines.push_back("SCENE_BOUNCES " + std::to_string(BOUNCES));
+    defines.push_back("SCENE_BVH_STACK_SIZE " + std::to_string(stackSize));
+    return defines;
+}
+
+std::vector<std::string> RayScene::ComputeDefines(int sizeX, int sizeY) const {
+    std::vector<std::string> defines = sceneDefines;
+    defines.push_back("LOCAL_SIZE_X " + std::to_string(sizeX));
+    defines.push_back("LOCAL_SIZE_Y " + std::to_string(sizeY));
+    return defines;
+}
+
+// Identifies the scene for the workgroup tuner: its defines, resolution and BVH
+uint64_t RayScene::SceneHash() const {
+    uint64_t hash = WorkgroupTuner::Hash(&SCREEN_WIDTH, sizeof(SCREEN_WIDTH));
+    hash = WorkgroupTuner::Hash(&SCREEN_HEIGHT, sizeof(SCREEN_HEIGHT), hash);
+    for (const std::string& define : sceneDefines)
+        hash = WorkgroupTuner::Hash(define.c_str(), define.size() + 1, hash);
+
+    // Field by field, the structs have padding
+    for (const BVHNode& node : sceneBVH.FlatNodes) {
+        const int counts[3] = { node.TriangleStartIndex, node.TriangleCount, node.ChildIndex };
+        hash = WorkgroupTuner::Hash(&node.Bounds.Min, sizeof(glm::vec3), hash);
+        hash = WorkgroupTuner::Hash(&node.Bounds.Max, sizeof(glm::vec3), hash);
+        hash = WorkgroupTuner::Hash(counts, sizeof(counts), hash);
+    }
+    return hash;
+}
+
+CameraSettings RayScene::CurrentCameraSettings() const {
+    CameraSettings cameraSettings;
+    cameraSettings.position = glm::vec3(camera.Position);
+    cameraSettings.direction = glm::vec3(camera.Orientation);
+    cameraSettings.fov = 90.0f;
+    return cameraSettings;
 }
 
 
@@ -532,6 +1159,30 @@ bool RayScene::SaveScreenshot(double timeInSeconds) {
     case RenderMode::PATH_TRACING_BIDIRECTIONAL:
         renderTechnique = "BiPathTracing";
         break;
+    case RenderMode::NEXT_EVENT_ESTIMATION:
+        renderTechnique = "NEE";
+        break;
+    case RenderMode::PSS_METROPLIS:
+        renderTechnique = "PSSMetropolis";
+        break;
+    case RenderMode::PATH_TRACING_BIDIRECTIONAL_LVC:
+        renderTechnique = "BiPathTracingLVC";
+        break;
+    case RenderMode::RESTIR_DI:
+        renderTechnique = "ReSTIRDI";
+        break;
+    case RenderMode::RESTIR_GI:
+        renderTechnique = "ReSTIRGI";
+        break;
+    case RenderMode::PROGRESSIVE_PHOTON_MAPPING:
+        renderTechnique = "PhotonMapping";
+        break;
+    case RenderMode::LIGHT_TRACING:
+        renderTechnique = "LightTracing";
+        break;
+    case RenderMode::WAVEFRONT_PATH_TRACING:
+        renderTechnique = "WavefrontPathTracing";
+        break;
     default:
         renderTechnique = "Unknown";
         break;
@@ -604,6 +1255,108 @@ bool RayScene::SaveScreenshot(double timeInSeconds) {
         return false;
     }
 }
+//
+// SetFrameUniforms() – Fills the FrameConstants block and writes it to this frame's ring buffer slot.
+// The block is bound once for every program built from compute.comp.
+//
+void RayScene::SetFrameUniforms(double timeInSeconds, bool reproject, bool hasMoved) {
+    UniformBlock& frame = *frameConstants;
+    frame.SetParameterMatrix(camera.cameraMatrix, "viewProj");
+    frame.SetParameterDouble(timeInSeconds, "uTime");
+    frame.SetParameterColor(glm::vec3(1.0f), "SkyColourHorizon");
+    frame.SetParameterColor(glm::vec3(0.08f, 0.37f, 0.73f), "SkyColourZenith");
+    frame.SetParameterColor(glm::normalize(glm::vec3(1.0f, -0.5f, -1.0f)), "SunLightDirection");
+    frame.SetParameterColor(glm::vec3(0.35f), "GroundColor");
+    frame.SetParameterFloat(500.0f, "SunFocus");
+    frame.SetParameterFloat(10.0f, "SunIntensity");
+    frame.SetParameterFloat(0.0f, "SunThreshold");
+    frame.SetParameterInt(DEBUGMODE, "DebugMode");
+    frame.SetParameterFloat(SKYSTRENGTH, "SkyStrength");
+    frame.SetParameterInt(BOUNCES, "FrameBounces");
+    frame.SetParameterInt(RAYSPERPIXEL, "NumberOfRays");
+    frame.SetParameterInt(PATH_REGENERATION ? 1 : 0, "PathRegeneration");
+    frame.SetParameterInt(METROPLIS_MUTATIONS, "NumberOfMutations");
+    frame.SetParameterInt(DEBUGTHRESHOLD, "DebugThreshold");
+    frame.SetParameterInt(DEBUGTEST, "DebugTest");
+    frame.SetParameterInt(LENSSUBPATHS, "LENSSUBPATHS");
+    frame.SetParameterInt(LIGHTSUBPATHS, "LIGHTSUBPATHS");
+
+    frame.SetParameterInt(1, "BurnInSamples");
+
+    frame.SetParameterInt(reproject ? 1 : 0, "TemporalReprojection");
+    frame.SetParameterInt(hasMoved ? 1 : 0, "CameraMoved");
+    frame.SetParameterFloat(REPROJECTION_TOLERANCE, "ReprojectionTolerance");
+    const int maxHistory = ACCUMULATION_FORMAT == GL_RGBA16F ? std::min(REPROJECTION_MAX_HISTORY, HALF_FLOAT_MAX_HISTORY) :
+        REPROJECTION_MAX_HISTORY;
+    frame.SetParameterInt(maxHistory, "MaxHistoryLength");
+    frame.SetParameterInt(firstHitPingPong, "FirstHitPingPong");
+    frame.SetParameterColor(previousCameraSettings.position, "PreviousCameraPosition");
+    frame.SetParameterColor(previousCameraSettings.direction, "PreviousCameraDirection");
+    frame.SetParameterFloat(previousCameraSettings.fov, "PreviousCameraFov");
+
+    frame.SetParameterInt(MLT_CHAINS, "MLTChains");
+    frame.SetParameterInt(MLT_BOOTSTRAP_SAMPLES, "MLTBootstrapSamples");
+    frame.SetParameterInt(MLT_MUTATIONS_PER_CHAIN, "MLTMutationsPerChain");
+    frame.SetParameterFloat(MLT_LARGE_STEP_PROBABILITY, "MLTLargeStepProbability");
+    frame.SetParameterFloat(MLT_SIGMA, "MLTSigma");
+
+    frame.SetParameterFloat(SPLAT_SCALE, "SplatScale");
+    frame.SetParameterInt(LIGHT_TRACING_PATHS, "LightTracingPaths");
+
+    frame.SetParameterInt(LVC_LIGHT_PATHS, "LVCLightPaths");
+    frame.SetParameterInt(LVC_CONNECTIONS, "LVCConnections");
+
+    frame.SetParameterInt(RESTIR_CANDIDATES, "ReSTIRCandidates");
+    frame.SetParameterInt(RESTIR_TEMPORAL_REUSE ? 1 : 0, "ReSTIRTemporalReuse");
+    frame.SetParameterInt(RESTIR_TEMPORAL_MAX_M, "ReSTIRTemporalMaxM");
+    frame.SetParameterInt(RESTIR_SPATIAL_SAMPLES, "ReSTIRSpatialSamples");
+    frame.SetParameterFloat(RESTIR_SPATIAL_RADIUS, "ReSTIRSpatialRadius");
+    frame.SetParameterFloat(RESTIR_MAX_JACOBIAN, "ReSTIRMaxJacobian");
+
+    frame.SetParameterInt(PPM_PHOTONS, "PPMPhotons");
+    frame.SetParameterInt(PPM_PHOTON_BOUNCES, "PPMPhotonBounces");
+
+    frame.SetParameterInt(RADIANCE_CACHE ? 1 : 0, "RadianceCache");
+    frame.SetParameterInt(RADIANCE_CACHE_MIN_BOUNCE, "RadianceCacheMinBounce");
+    frame.SetParameterFloat(RADIANCE_CACHE_MAX_GLOSSINESS, "RadianceCacheMaxGlossiness");
+    frame.SetParameterFloat(RADIANCE_CACHE_CELL_SIZE, "RadianceCacheCellSize");
+    frame.SetParameterFloat(RADIANCE_CACHE_REFERENCE_DISTANCE, "RadianceCacheReferenceDistance");
+    frame.SetParameterInt(RADIANCE_CACHE_MIN_SAMPLES, "RadianceCacheMinSamples");
+    frame.SetParameterInt(RADIANCE_CACHE_MAX_SAMPLES, "RadianceCacheMaxSamples");
+
+    frame.SetParameterInt(RAY_CONE_TEXTURE_LOD ? 1 : 0, "RayConeTextureLod");
+    frame.SetParameterFloat(RAY_CONE_ROUGH_SPREAD, "RayConeRoughSpread");
+
+    frame.SetParameterInt(pathGuiding ? 1 : 0, "PathGuiding");
+    if (pathGuiding) {
+        frame.SetParameterInt(pathGuiding->IsTraining() ? 1 : 0, "GuidingTraining");
+        frame.SetParameterFloat(GUIDING_BSDF_FRACTION, "GuidingBSDFFraction");
+        frame.SetParameterFloat(PathGuiding::RECORD_SCALE, "GuidingRecordScale");
+        frame.SetParameterColor(pathGuiding->BoundsMin, "GuidingBoundsMin");
+        frame.SetParameterColor(pathGuiding->BoundsMax, "GuidingBoundsMax");
+    }
+
+    frame.SetParameterInt(environmentMap ? 1 : 0, "UseEnvironmentMap");
+    frame.SetParameterFloat(environmentMap ? environmentMap->Integral : 0.0f, "EnvironmentIntegral");
+
+    int rMode = static_cast<int>(renderMode);
+    frame.SetParameterInt(rMode, "RENDER_MODE");
+    frame.SetParameterInt(SCREEN_WIDTH / METROPLIS_DISPATCH_X, "METROPLIS_DISPATCH_X");
+    frame.SetParameterInt(SCREEN_HEIGHT / METROPLIS_DISPATCH_Y, "METROPLIS_DISPATCH_Y");
+
+    frameRing->Write(GL_UNIFORM_BUFFER, frame.Binding, frame.Data.data(), frame.Data.size());
+}
+
+//
+// BindFrameTextures() – Samplers of a program built from compute.comp, which the uniform block can't hold.
+//
+void RayScene::BindFrameTextures(Shader& program) {
+    program.Activate();
+    program.SetParameterSampler("diffuseTextures", MODEL_TEXTURE_UNIT);
+    if (environmentMap)
+        environmentMap->Bind(program);
+}
+
 //
 // OnBufferSwap() – Called on each buffer swap to update frame data, dispatch the compute shader,
 // copy accumulated image data, update camera settings, and render the final output.
@@ -612,6 +1365,7 @@ void RayScene::OnBufferSwap(Window& win) {
     auto currentTimePoint = std::chrono::steady_clock::now();
     std::chrono::duration<float> elapsedSeconds = currentTimePoint - startTime;
     double timeInSeconds = elapsedSeconds.count();
+    profiler->BeginFrame();
 
     // Toggle debug mode on key press (B key)
     static bool wasPressed = false;
@@ -632,90 +1386,140 @@ void RayScene::OnBufferSwap(Window& win) {
     SceneVAO.Bind();
     bool hasMoved = camera.Inputs(win.instance);
     camera.UpdateMatrix(45.0f, 0.1f, 100.0f);
-    camera.Matrix(computeShader, "viewProj");
 
-    if (hasMoved) {
+    // Metropolis chains and splatted light paths cannot be reprojected, so
+    // those modes still restart accumulation on every camera move.
+    bool reproject = TEMPORAL_REPROJECTION && renderMode != METROPLIS && renderMode != PSS_METROPLIS &&
+        renderMode != LIGHT_TRACING;
+
+    if (hasMoved && !reproject) {
         Frame = 0;
         GLfloat clearColor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
         GLfloat whiteClear[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
 
         // Clear textures at mipmap level 0.
-        glClearTexImage(tex.ID, 0, GL_RGBA, GL_FLOAT, clearColor);
-        glClearTexImage(oldTex.ID, 0, GL_RGBA, GL_FLOAT, clearColor);
-        glClearTexImage(biasTex.ID, 0, GL_RGBA, GL_FLOAT, clearColor);
-        glClearTexImage(metroplisColorsTex.ID, 0, GL_RGBA, GL_FLOAT, clearColor);
-        glClearTexImage(metroplisDirectionsTex.ID, 0, GL_RGBA, GL_FLOAT, clearColor);
+        for (const std::unique_ptr<Texture>* texture : { &accumulationTargets[0], &accumulationTargets[1], &biasTex,
+                                                         &metroplisColorsTex, &metroplisDirectionsTex }) {
+            if (*texture)
+                glClearTexImage((*texture)->ID, 0, GL_RGBA, GL_FLOAT, clearColor);
+        }
+        if (splatBuffer)
+            glClearNamedBufferData(splatBuffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
     }
+    if (hasMoved && renderMode == PROGRESSIVE_PHOTON_MAPPING)
+        ResetPhotonMapping();
 
     glMemoryBarrier(GL_ALL_BARRIER_BITS);
 
-    // Copy the current accumulation texture to the old texture
-    glCopyImageSubData(tex.ID, GL_TEXTURE_2D, 0, 0, 0, 0,
-        oldTex.ID, GL_TEXTURE_2D, 0, 0, 0, 0,
-        SCREEN_WIDTH, SCREEN_HEIGHT, 1);
+    // Last frame's output becomes the history this frame reads
+    SwapAccumulationTargets();
+
+    // Still frames keep the visibility buffer of the last camera change
+    if (visibilityBuffer && hasMoved) {
+        profiler->BeginScope("Visibility buffer");
+        visibilityBuffer->Render(CurrentCameraSettings());
+        profiler->EndScope();
+    }
 
-    // Update Frame and camera settings in SSBOs
-    double frame = computeShader.StoreSSBO<double>(Frame, 4);
+    // Frame number, camera and frame constants go to this frame's slot of the ring buffer
+    profiler->BeginScope("Frame uniforms");
+    frameRing->BeginFrame();
+    frameRing->Write(GL_SHADER_STORAGE_BUFFER, 4, &Frame, sizeof(Frame));
+    bool firstFrame = Frame == 0;
     Frame++;
 
-    CameraSettings cameraSettings;
-    cameraSettings.position = glm::vec3(camera.Position);
-    cameraSettings.direction = glm::vec3(camera.Orientation);
-    cameraSettings.fov = 90.0f;
-    GLuint camSettings = computeShader.StoreSSBO<CameraSettings>(cameraSettings, 3);
+    CameraSettings cameraSettings = CurrentCameraSettings();
+    frameRing->Write(GL_SHADER_STORAGE_BUFFER, 3, &cameraSettings, sizeof(cameraSettings));
 
     // Set shader uniform parameters
-    computeShader.Activate();
-    computeShader.SetParameterFloat(timeInSeconds, "uTime");
-    computeShader.SetParameterColor(glm::vec3(1.0f), "SkyColourHorizon");
-    computeShader.SetParameterColor(glm::vec3(0.08f, 0.37f, 0.73f), "SkyColourZenith");
-    computeShader.SetParameterColor(glm::normalize(glm::vec3(1.0f, -0.5f, -1.0f)), "SunLightDirection");
-    computeShader.SetParameterColor(glm::vec3(0.35f), "GroundColor");
-    computeShader.SetParameterFloat(500.0f, "SunFocus");
-    computeShader.SetParameterFloat(10.0f, "SunIntensity");
-    computeShader.SetParameterFloat(0.0f, "SunThreshold");
-    computeShader.SetParameterInt(DEBUGMODE, "DebugMode");
-    computeShader.SetParameterFloat(SKYSTRENGTH, "SkyStrength");
-    computeShader.SetParameterInt(BOUNCES, "NumberOfBounces");
-    computeShader.SetParameterInt(RAYSPERPIXEL, "NumberOfRays");
-    computeShader.SetParameterInt(METROPLIS_MUTATIONS, "NumberOfMutations");
-    computeShader.SetParameterInt(DEBUGTHRESHOLD, "DebugThreshold");
-    computeShader.SetParameterInt(DEBUGTEST, "DebugTest");
-    computeShader.SetParameterInt(LENSSUBPATHS, "LENSSUBPATHS");
-    computeShader.SetParameterInt(LIGHTSUBPATHS, "LIGHTSUBPATHS");
-
-    computeShader.SetParameterInt(1, "BurnInSamples");
-
-    int rMode = static_cast<int>(renderMode);
-    computeShader.SetParameterInt(rMode, "RENDER_MODE");
-    computeShader.SetParameterInt(SCREEN_WIDTH / METROPLIS_DISPATCH_X, "METROPLIS_DISPATCH_X");
-    computeShader.SetParameterInt(SCREEN_HEIGHT / METROPLIS_DISPATCH_Y, "METROPLIS_DISPATCH_Y");
+    SetFrameUniforms(timeInSeconds, reproject, hasMoved);
+    if (wavefront) {
+        for (Shader& stage : wavefront->Programs())
+            BindFrameTextures(stage);
+    }
+    BindFrameTextures(computeShader);
+    profiler->EndScope();
 
     glMemoryBarrier(GL_ALL_BARRIER_BITS);
 
     // Dispatch compute shader
-    int gX = (renderMode == METROPLIS) ? (SCREEN_WIDTH / METROPLIS_DISPATCH_X) : (SCREEN_WIDTH / LAYOUT_SIZE_X);
-    int gY = (renderMode == METROPLIS) ? (SCREEN_HEIGHT / METROPLIS_DISPATCH_Y) : (SCREEN_HEIGHT / LAYOUT_SIZE_Y);
-    computeShader.Dispatch(gX, gY, 1);
+    profiler->BeginScope("Compute dispatch");
+    int gX = (renderMode == METROPLIS) ? (SCREEN_WIDTH / METROPLIS_DISPATCH_X) : ScreenGroupsX();
+    int gY = (renderMode == METROPLIS) ? (SCREEN_HEIGHT / METROPLIS_DISPATCH_Y) : ScreenGroupsY();
+    if (renderMode == PSS_METROPLIS)
+        DispatchPrimarySampleMetropolis(firstFrame);
+    else if (renderMode == PATH_TRACING_BIDIRECTIONAL_LVC)
+        DispatchLightVertexCache(gX, gY);
+    else if (renderMode == RESTIR_DI || renderMode == RESTIR_GI)
+        DispatchReSTIR(gX, gY);
+    else if (renderMode == PROGRESSIVE_PHOTON_MAPPING)
+        DispatchPhotonMapping(gX, gY);
+    else if (renderMode == LIGHT_TRACING)
+        DispatchLightTracing();
+    else if (renderMode == WAVEFRONT_PATH_TRACING)
+        wavefront->Render(gX, gY, BOUNCES, *profiler);
+    else if (renderMode == METROPLIS)
+        computeShader.Dispatch(gX, gY, 1);
+    else
+        DispatchScreen(gX, gY);
+    profiler->EndScope();
+
+    // The Metropolis mutations only splat, the resolve turns them into the image
+    profiler->BeginScope("Resolve");
+    if (renderMode == METROPLIS)
+        DispatchSplatResolve();
+    glMemoryBarrier(GL_ALL_BARRIER_BITS);
+
+    // The Metropolis burn-in leaves one luminance average per chain in metroSample; their mean is b
+    if (renderMode == METROPLIS && firstFrame) {
+        reduction->ReduceImage(metroplisColorsTex->ID, gX * layoutSizeX, gY * layoutSizeY,
+            glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), true, REDUCTION_SLOT_MLT_NORMALIZATION);
+        reduction->CopyResultToTexel(REDUCTION_SLOT_MLT_NORMALIZATION, biasTex->ID, 0, 0);
+    }
+
+    if (AUTO_EXPOSURE) {
+        reduction->AccumulateHistogram(CurrentTarget().ID, SCREEN_WIDTH, SCREEN_HEIGHT);
+        reduction->UpdateExposure(REDUCTION_SLOT_EXPOSURE, EXPOSURE_ADAPTATION, EXPOSURE_LOW_PERCENTILE, EXPOSURE_HIGH_PERCENTILE);
+    }
     glMemoryBarrier(GL_ALL_BARRIER_BITS);
+    profiler->EndScope();
+
+    // Refines the guiding trees at the end of each training iteration
+    if (pathGuiding) {
+        profiler->BeginScope("Path guiding");
+        pathGuiding->EndFrame();
+        profiler->EndScope();
+    }
+
+    // This frame becomes the reprojection source for the next one
+    previousCameraSettings = cameraSettings;
+    firstHitPingPong = 1 - firstHitPingPong;
 
     // Bind textures for final rendering
-    tex.texUnit(shader, "tex0");
-    biasTex.texUnit(shader, "tex1");
-    oldTex.texUnit(shader, "tex2");
+    profiler->BeginScope("Display");
+    CurrentTarget().texUnit(shader, "tex0");
 
     //tex.texUnit(shader, "diffuseTextures");
 
     shader.SetParameterInt(Frame, "Frame");
     shader.Activate();
+    shader.SetParameterInt(AUTO_EXPOSURE ? 1 : 0, "AutoExposure");
+    shader.SetParameterInt(REDUCTION_SLOT_EXPOSURE, "ExposureSlot");
+    shader.SetParameterFloat(EXPOSURE_KEY, "ExposureKey");
 
     glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    profiler->EndScope();
 
-    computeShader.DeleteSSBOs();
+    // The slot is reused once the GPU is past this frame
+    frameRing->EndFrame();
 
     // ‑‑ build one single string ------------------------------------------
+    profiler->BeginScope("Text");
+    const std::vector<Profiler::Average>& averages = profiler->Averages();  // [0] is the whole frame
     std::ostringstream ss;
     ss << "fps : " << static_cast<int>(fps)
+        << "   gpu : " << std::fixed << std::setprecision(2)
+        << (averages.empty() ? 0.0 : averages[0].gpuMilliseconds) << " ms"
         << "   pos : (" << std::fixed << std::setprecision(2)
         << camera.Position.x << ", "
         << camera.Position.y << ", "
@@ -727,14 +1531,19 @@ void RayScene::OnBufferSwap(Window& win) {
     textShader.Activate();
     // Render FPS text on the screen
     //text.RenderText(textShader, ss.str(), 25.0f, 25.0f, 1.0f, glm::vec3(1.0f));
+    profiler->EndScope();
 
     auto elapsedSinceLastScreenshot = std::chrono::duration_cast<std::chrono::seconds>(
         currentTimePoint - lastScreenshotTime).count();
     if (elapsedSinceLastScreenshot >= ScreenshotFrequency) {  // 60 seconds = 1 minute
+        profiler->BeginScope("Screenshot");
         if (SaveScreenshot(timeInSeconds)) {
             lastScreenshotTime = currentTimePoint;  // Update the time only if save was successful
         }
+        profiler->EndScope();
     }
+
+    profiler->EndFrame();
 }
 
 
@@ -775,5 +1584,17 @@ void RayScene::OnWindowClose(Window& win) {
     SceneVBO->Delete();
     SceneEBO->Delete();
     shader.Delete();
-    tex.Delete();
+    computeShader.Delete();
+    if (!sceneBuffers.empty())
+        glDeleteBuffers(static_cast<GLsizei>(sceneBuffers.size()), sceneBuffers.data());
+    sceneBuffers.clear();
+    for (const std::unique_ptr<Texture>* texture : { &accumulationTargets[0], &accumulationTargets[1], &biasTex,
+                                                     &metroplisColorsTex, &metroplisDirectionsTex }) {
+        if (*texture)
+            (*texture)->Delete();
+    }
+
+    if (PROFILE_TRACE_PATH)
+        profiler->WriteTrace(PROFILE_TRACE_PATH);
+    profiler->Delete();
 }
\ No newline at end of file
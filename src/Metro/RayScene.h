@@ -5,9 +5,18 @@
 #include "../Core/Camera.h"
 #include "../Core/Texture.h"
 #include "../Core/Shader.h"
+#include "../Core/RingBuffer.h"
+#include "../Core/UniformBlock.h"
+#include "../Core/Profiler.h"
 #include "../Core/Model.h"
 #include "../Lib/ASSIMP.cpp"
 #include "../Core/Text.h"
+#include "PathGuiding.h"
+#include "EnvironmentMap.h"
+#include "GpuReduction.h"
+#include "WavefrontPipeline.h"
+#include "WorkgroupTuner.h"
+#include "VisibilityBuffer.h"
 
 class RayScene : public Scene {
 public:
@@ -19,12 +28,17 @@ public:
     Shader copyAccumShader;
     Shader textShader;
 
-    Texture tex;
-    Texture biasTex;
-    Texture oldTex;
+    // Ping-ponged accumulation targets: the current one is image 0 (screen), the other image 2
+    // (oldScreen). The second target is null in the modes that never read the history.
+    std::unique_ptr<Texture> accumulationTargets[2];
+    int accumulationTarget = 0;
+    Texture& CurrentTarget() { return *accumulationTargets[accumulationTarget]; }
+    void SwapAccumulationTargets();
 
-    Texture metroplisDirectionsTex;
-    Texture metroplisColorsTex;
+    // Metropolis normalization texel and chain state, only created in that mode.
+    std::unique_ptr<Texture> biasTex;
+    std::unique_ptr<Texture> metroplisDirectionsTex;
+    std::unique_ptr<Texture> metroplisColorsTex;
 
     Camera camera;
 
@@ -36,8 +50,92 @@ public:
 
     double Frame = 0;
 
-    void AddSurfaces();
+    // Temporal reprojection state: first-hit positions of the last two frames
+    // (ping-ponged halves of one buffer) and the camera of the previous frame.
+    GLuint firstHitBuffer;
+    int firstHitPingPong = 0;
+    CameraSettings previousCameraSettings;
+
+    // Workgroup size compute.comp is built with, LAYOUT_SIZE_X/Y unless the autotuner picked another.
+    int layoutSizeX;
+    int layoutSizeY;
+    void AutotuneWorkgroupSize(const WorkgroupTuner& tuner);
+    void TuningFrame();
+
+    // Persistent threads: tile counter of the screen passes and the workgroups launched for them.
+    GLuint persistentCounterBuffer = 0;
+    int persistentWorkgroups = 0;
+    int ScreenGroupsX() const;
+    int ScreenGroupsY() const;
+    int PersistentWorkgroupCount() const;
+    void DispatchScreen(int gX, int gY);
+
+    // Fixed-point RGB splat counters of the Metropolis and light tracing modes.
+    GLuint splatBuffer = 0;
+    void DispatchSplatResolve();
+
+    // Primary sample space Metropolis: the seed of the current bootstrap
+    // (bumped whenever the chains are reseeded).
+    int mltSeed = 0;
+    void DispatchPrimarySampleMetropolis(bool bootstrap);
+
+    // Light tracing: light paths splatting their camera connections.
+    void DispatchLightTracing();
+
+    // Light vertex cache: shared light subpath vertices plus their append counter.
+    GLuint lightVertexCacheBuffer = 0;
+    void DispatchLightVertexCache(int gX, int gY);
+
+    // ReSTIR DI and GI: candidate/temporal pass followed by the spatial pass.
+    void DispatchReSTIR(int gX, int gY);
+
+    // Progressive photon mapping: photons, hash grid and the shrinking gather radius.
+    GLuint photonBuffer = 0;
+    GLuint photonGridBuffer = 0;
+    float ppmRadius = 0.0f;
+    int ppmIteration = 0;
+    void DispatchPhotonMapping(int gX, int gY);
+    void ResetPhotonMapping();
+
+    // Path guiding SD-tree, only created in path tracing mode.
+    std::unique_ptr<PathGuiding> pathGuiding;
+
+    // Importance-sampled HDR sky, null when the procedural sky is used.
+    std::unique_ptr<EnvironmentMap> environmentMap;
+
+    // Per-frame data: persistently mapped ring buffer and the FrameConstants block of compute.comp.
+    std::unique_ptr<RingBuffer> frameRing;
+    std::unique_ptr<UniformBlock> frameConstants;
+    void SetFrameUniforms(double timeInSeconds, bool reproject, bool hasMoved);
+    void BindFrameTextures(Shader& program);
+
+    // CPU and GPU times of the passes below, averaged once per second and exported as a trace.
+    std::unique_ptr<Profiler> profiler;
+
+    // GPU sums and histograms: Metropolis normalization and auto-exposure.
+    std::unique_ptr<GpuReduction> reduction;
+
+    // Wavefront path tracing: stage programs and their path queues, only created in that mode.
+    std::unique_ptr<WavefrontPipeline> wavefront;
+
+    // Rasterized primary hits of the hybrid path tracer, null unless HYBRID_PRIMARY_HITS is used.
+    std::unique_ptr<VisibilityBuffer> visibilityBuffer;
+
+    // Scene and per-mode SSBOs live as long as the scene. They are owned here rather than by
+    // computeShader, which is only built once the scene is known and replaced while tuning.
+    std::vector<GLuint> sceneBuffers;
+    template <class T>
+    GLuint StoreSceneBuffer(const T& data, int binding);
+
+    std::vector<TraceCircle> AddSurfaces();
     void AddMeshes();
+
+    // #defines compute.comp is specialized with: the render mode plus what the loaded scene uses
+    std::vector<std::string> sceneDefines;
+    std::vector<std::string> SceneDefines(const std::vector<TraceCircle>& circles) const;
+    std::vector<std::string> ComputeDefines(int sizeX, int sizeY) const;
+    uint64_t SceneHash() const;
+    CameraSettings CurrentCameraSettings() const;
     void SetupEmissiveObjectsBuffer(const std::vector<TraceCircle> circles);
 
     bool SaveScreenshot(double timeInSeconds);
@@ -47,5 +145,6 @@ public:
     void OnBufferSwap(Window& win) override;
     void OnWindowLoad(Window& win) override;
     void OnWindowClose(Window& win) override;
-    RayScene(Window& win);
+    // retuneWorkgroups ignores the cached workgroup size and times the candidates again
+    RayScene(Window& win, bool retuneWorkgroups = false);
 };
\ No newline at end of file
@@ -0,0 +1,86 @@
+#include "VisibilityBuffer.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <iostream>
+
+VisibilityBuffer::VisibilityBuffer(int width, int height, const std::vector<int>& modelTriangleOffsets) :
+    shader("shaders/visibility.vert", "shaders/visibility.frag"),
+    width(width),
+    height(height),
+    modelTriangleOffsets(modelTriangleOffsets)
+{
+    glCreateTextures(GL_TEXTURE_2D, 1, &visibilityTexture);
+    glTextureStorage2D(visibilityTexture, 1, GL_RG32UI, width, height);
+    glCreateTextures(GL_TEXTURE_2D, 1, &depthTexture);
+    glTextureStorage2D(depthTexture, 1, GL_DEPTH_COMPONENT32F, width, height);
+
+    glCreateFramebuffers(1, &framebuffer);
+    glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, visibilityTexture, 0);
+    glNamedFramebufferTexture(framebuffer, GL_DEPTH_ATTACHMENT, depthTexture, 0);
+    if (glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cerr << "Visibility buffer: incomplete framebuffer" << std::endl;
+
+    // The vertex shader pulls its vertices from the triangle buffer, the vertex array stays empty
+    glCreateVertexArrays(1, &vertexArray);
+
+    // Nothing rasterized yet, compute.comp traverses the BVH until the first Render()
+    GLuint clear[4] = { 0, 0, 0, 0 };
+    glClearTexImage(visibilityTexture, 0, GL_RG_INTEGER, GL_UNSIGNED_INT, clear);
+    glBindImageTexture(IMAGE_BINDING, visibilityTexture, 0, GL_FALSE, 0, GL_READ_ONLY, GL_RG32UI);
+}
+
+VisibilityBuffer::~VisibilityBuffer() {
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &visibilityTexture);
+    glDeleteTextures(1, &depthTexture);
+    glDeleteVertexArrays(1, &vertexArray);
+    shader.Delete();
+}
+
+// Same rays as compute.comp: fov is vertical, right = forward x +Y and up = right x forward
+glm::mat4 VisibilityBuffer::ViewProjection(const CameraSettings& camera) const {
+    glm::vec3 forward = glm::normalize(camera.direction);
+    glm::vec3 right = glm::normalize(glm::cross(forward, glm::vec3(0.0f, 1.0f, 0.0f)));
+    glm::vec3 up = glm::cross(right, forward);
+    glm::mat4 view = glm::lookAt(camera.position, camera.position + forward, up);
+    glm::mat4 projection = glm::perspective(glm::radians(camera.fov), float(width) / float(height), NEAR_PLANE, FAR_PLANE);
+    return projection * view;
+}
+
+void VisibilityBuffer::Render(const CameraSettings& camera) {
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+    GLint vertexArrayBinding = 0;
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vertexArrayBinding);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, width, height);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glDisable(GL_CULL_FACE);   // Triangles are double-sided in the path tracer as well
+
+    GLuint clearVisibility[4] = { 0, 0, 0, 0 };
+    GLfloat clearDepth = 1.0f;
+    glClearNamedFramebufferuiv(framebuffer, GL_COLOR, 0, clearVisibility);
+    glClearNamedFramebufferfv(framebuffer, GL_DEPTH, 0, &clearDepth);
+
+    shader.Activate();
+    glm::mat4 viewProjection = ViewProjection(camera);
+    glUniformMatrix4fv(shader.UniformLocation("ViewProjection"), 1, GL_FALSE, &viewProjection[0][0]);
+    glBindVertexArray(vertexArray);
+    for (size_t model = 0; model + 1 < modelTriangleOffsets.size(); model++) {
+        int first = modelTriangleOffsets[model];
+        int count = modelTriangleOffsets[model + 1] - first;
+        shader.SetParameterInt(static_cast<int>(model), "ModelIndex");
+        glDrawArrays(GL_TRIANGLES, first * 3, count * 3);
+    }
+    glBindVertexArray(static_cast<GLuint>(vertexArrayBinding));   // The caller's VAO draws the display quad
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    if (!depthTest)
+        glDisable(GL_DEPTH_TEST);
+    if (cullFace)
+        glEnable(GL_CULL_FACE);
+}
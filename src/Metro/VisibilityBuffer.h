@@ -0,0 +1,40 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "../Core/Shader.h"
+#include "ComputeStructures.h"
+
+//
+// VisibilityBuffer – Primary hits of the hybrid path tracer, rasterized by visibility.vert/.frag
+// from the path tracer's own triangle buffer. Each pixel holds the index of the closest triangle
+// at its centre plus its model, in an RG32UI image compute.comp reads at IMAGE_BINDING. The
+// projection matches the camera rays of compute.comp, and the buffer only has to be rendered
+// again when the camera changes.
+//
+class VisibilityBuffer {
+public:
+    // modelTriangleOffsets: first triangle of each model, followed by the total triangle count
+    VisibilityBuffer(int width, int height, const std::vector<int>& modelTriangleOffsets);
+    ~VisibilityBuffer();
+
+    void Render(const CameraSettings& camera);
+
+    static const int IMAGE_BINDING = 3;     // Must match visibilityBuffer in compute.comp
+
+private:
+    static constexpr float NEAR_PLANE = 0.01f;
+    static constexpr float FAR_PLANE = 10000.0f;
+
+    Shader shader;
+    GLuint framebuffer = 0;
+    GLuint visibilityTexture = 0;
+    GLuint depthTexture = 0;
+    GLuint vertexArray = 0;
+    int width;
+    int height;
+    std::vector<int> modelTriangleOffsets;
+
+    glm::mat4 ViewProjection(const CameraSettings& camera) const;
+};
@@ -0,0 +1,111 @@
+#include "WavefrontPipeline.h"
+
+static const char* STAGE_DEFINES[] = {
+    "WAVEFRONT_STAGE_GENERATE",
+    "WAVEFRONT_STAGE_EXTEND",
+    "WAVEFRONT_STAGE_SHADE",
+    "WAVEFRONT_STAGE_SHADOW",
+    "WAVEFRONT_STAGE_ACCUMULATE"
+};
+
+// Profiler scope names, string literals as the profiler keeps the pointers
+static const char* STAGE_NAMES[] = {
+    "Wavefront generate",
+    "Wavefront extend",
+    "Wavefront shade",
+    "Wavefront shadow",
+    "Wavefront accumulate"
+};
+
+WavefrontPipeline::WavefrontPipeline(int pathCount, const std::vector<std::string>& defines) :
+    pathCount(pathCount)
+{
+    for (int stage = 0; stage < STAGE_COUNT; stage++) {
+        std::vector<std::string> stageDefines = defines;
+        stageDefines.push_back(STAGE_DEFINES[stage]);
+        stages.emplace_back("shaders/compute.comp", stageDefines);
+        stages[stage].Activate();
+        stages[stage].SetParameterInt(pathCount, "WavefrontQueueCapacity");
+    }
+
+    // Headers are {count, groups x, groups y, groups z}; y and z stay 1, the rest is cleared per frame
+    std::vector<GLuint> queueData(4 * QUEUES + static_cast<size_t>(QUEUES) * pathCount, 0);
+    for (int queue = 0; queue < QUEUES; queue++) {
+        queueData[4 * queue + 2] = 1;
+        queueData[4 * queue + 3] = 1;
+    }
+
+    glCreateBuffers(1, &pathBuffer);
+    glCreateBuffers(1, &queueBuffer);
+    glNamedBufferData(pathBuffer, static_cast<GLsizeiptr>(pathCount) * PATH_SIZE, nullptr, GL_DYNAMIC_COPY);
+    glNamedBufferData(queueBuffer, queueData.size() * sizeof(GLuint), queueData.data(), GL_DYNAMIC_COPY);
+    BindBuffers();
+}
+
+WavefrontPipeline::~WavefrontPipeline() {
+    glDeleteBuffers(1, &pathBuffer);
+    glDeleteBuffers(1, &queueBuffer);
+    for (Shader& stage : stages)
+        stage.Delete();
+}
+
+void WavefrontPipeline::BindBuffers() {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, PATH_BINDING, pathBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, QUEUE_BINDING, queueBuffer);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, queueBuffer);
+}
+
+// Empties a queue by zeroing its count and x group count
+void WavefrontPipeline::ClearQueue(int queue) {
+    glClearNamedBufferSubData(queueBuffer, GL_RG32UI, queue * 4 * sizeof(GLuint), 2 * sizeof(GLuint),
+        GL_RG_INTEGER, GL_UNSIGNED_INT, nullptr);
+}
+
+//
+// Render() – Generates a camera path per pixel into the first extend queue, then runs
+// extend, shade and shadow once per bounce over whatever the previous stage appended.
+// Shade moves the surviving paths to the other extend queue, which becomes the input of
+// the next bounce. The frame ends with the usual accumulation.
+//
+void WavefrontPipeline::Render(int gX, int gY, int bounces, Profiler& profiler) {
+    BindBuffers();
+
+    for (int queue = 0; queue < QUEUES; queue++)
+        ClearQueue(queue);
+
+    int input = 0;
+    stages[STAGE_GENERATE].Activate();
+    stages[STAGE_GENERATE].SetParameterInt(input, "WavefrontInputQueue");
+    DispatchStage(STAGE_GENERATE, gX, gY, profiler);
+
+    for (int bounce = 0; bounce < bounces; bounce++) {
+        int output = 1 - input;
+        ClearQueue(output);
+        ClearQueue(SHADOW_QUEUE);
+
+        for (Stage stage : { STAGE_EXTEND, STAGE_SHADE }) {
+            stages[stage].Activate();
+            stages[stage].SetParameterInt(input, "WavefrontInputQueue");
+            stages[stage].SetParameterInt(output, "WavefrontOutputQueue");
+            DispatchStageIndirect(stage, input, profiler);
+        }
+        stages[STAGE_SHADOW].Activate();
+        DispatchStageIndirect(STAGE_SHADOW, SHADOW_QUEUE, profiler);
+
+        input = output;
+    }
+
+    stages[STAGE_ACCUMULATE].Activate();
+    DispatchStage(STAGE_ACCUMULATE, gX, gY, profiler);
+}
+
+// The profiler sums the scopes by name, so a stage's bounces add up to its time per frame
+void WavefrontPipeline::DispatchStage(Stage stage, int gX, int gY, Profiler& profiler) {
+    ProfileScope scope(profiler, STAGE_NAMES[stage]);
+    stages[stage].Dispatch(gX, gY, 1);
+}
+
+void WavefrontPipeline::DispatchStageIndirect(Stage stage, int queue, Profiler& profiler) {
+    ProfileScope scope(profiler, STAGE_NAMES[stage]);
+    stages[stage].DispatchIndirect(static_cast<GLintptr>((4 * queue + 1) * sizeof(GLuint)));
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <glad/glad.h>
+#include <vector>
+
+#include "../Core/Profiler.h"
+#include "../Core/Shader.h"
+
+//
+// WavefrontPipeline – The NEE path tracer of RENDER_MODE_10 run as one compute program per stage
+// (generate, extend, shade, shadow, accumulate), each built from compute.comp with its
+// WAVEFRONT_STAGE_* define. Stages hand paths to each other through queues of path indices whose
+// headers double as glDispatchComputeIndirect arguments, so queue sizes never reach the CPU.
+// Every dispatch is a scope of the frame profiler, so the stages show up in its averages and trace.
+//
+class WavefrontPipeline {
+public:
+    // defines are added to each stage's own WAVEFRONT_STAGE_* define
+    WavefrontPipeline(int pathCount, const std::vector<std::string>& defines);
+    ~WavefrontPipeline();
+
+    // Traces one sample per pixel of the gX x gY workgroup grid and accumulates it into the screen
+    void Render(int gX, int gY, int bounces, Profiler& profiler);
+
+    // Stage programs, they need the same frame uniforms as the megakernel
+    std::vector<Shader>& Programs() { return stages; }
+
+    static const int PATH_BINDING = 41;
+    static const int QUEUE_BINDING = 42;
+
+private:
+    // Must match the WAVEFRONT_STAGE_* defines handled in compute.comp
+    enum Stage {
+        STAGE_GENERATE = 0,
+        STAGE_EXTEND = 1,
+        STAGE_SHADE = 2,
+        STAGE_SHADOW = 3,
+        STAGE_ACCUMULATE = 4,
+        STAGE_COUNT = 5
+    };
+
+    static const int QUEUES = 3;                  // Must match WAVEFRONT_QUEUES in compute.comp
+    static const int SHADOW_QUEUE = 2;
+    static const int PATH_SIZE = 208;             // sizeof(WavefrontPath) in compute.comp
+
+    std::vector<Shader> stages;
+    GLuint pathBuffer = 0;
+    GLuint queueBuffer = 0;
+    int pathCount;
+
+    void BindBuffers();
+    void ClearQueue(int queue);
+    void DispatchStage(Stage stage, int gX, int gY, Profiler& profiler);
+    void DispatchStageIndirect(Stage stage, int queue, Profiler& profiler);
+};
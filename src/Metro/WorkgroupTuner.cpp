@@ -0,0 +1,93 @@
+#include "WorkgroupTuner.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+// One "<key> <x> <y>" line per GPU and scene, next to the program binaries
+const char* WorkgroupTuner::CACHE_FILE = "shadercache/workgroups.txt";
+
+WorkgroupTuner::WorkgroupTuner(uint64_t sceneHash) {
+    // Binaries and timings are only valid for the driver that produced them
+    uint64_t hash = sceneHash;
+    for (GLenum driverString : { GL_VENDOR, GL_RENDERER, GL_VERSION }) {
+        const char* value = reinterpret_cast<const char*>(glGetString(driverString));
+        hash = Hash(value ? value : "", value ? std::strlen(value) + 1 : 1, hash);
+    }
+
+    std::ostringstream text;
+    text << std::hex << std::setw(16) << std::setfill('0') << hash;
+    key = text.str();
+}
+
+uint64_t WorkgroupTuner::Hash(const void* data, size_t size, uint64_t hash) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+bool WorkgroupTuner::Load(Size& size) const {
+    std::ifstream in(CACHE_FILE);
+    std::string lineKey;
+    Size lineSize;
+    while (in >> lineKey >> lineSize.x >> lineSize.y) {
+        if (lineKey == key && lineSize.x > 0 && lineSize.y > 0) {
+            size = lineSize;
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkgroupTuner::Save(Size size) const {
+    // Keeps the entries of other GPUs and scenes, replacing this one
+    std::vector<std::string> lines;
+    std::ifstream in(CACHE_FILE);
+    for (std::string line; std::getline(in, line);) {
+        if (!line.empty() && line.compare(0, key.size(), key) != 0)
+            lines.push_back(line);
+    }
+    in.close();
+    lines.push_back(key + " " + std::to_string(size.x) + " " + std::to_string(size.y));
+
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(CACHE_FILE).parent_path(), error);
+    std::ofstream out(CACHE_FILE);
+    if (!out) {
+        std::cerr << "Workgroup tuner: can't write " << CACHE_FILE << std::endl;
+        return;
+    }
+    for (const std::string& line : lines)
+        out << line << "\n";
+}
+
+double WorkgroupTuner::Time(const std::function<void()>& frame) {
+    for (int i = 0; i < WARMUP_FRAMES; i++)
+        frame();
+
+    GLuint queries[TIMED_FRAMES];
+    glGenQueries(TIMED_FRAMES, queries);
+    for (int i = 0; i < TIMED_FRAMES; i++) {
+        glBeginQuery(GL_TIME_ELAPSED, queries[i]);
+        frame();
+        glEndQuery(GL_TIME_ELAPSED);
+    }
+
+    std::vector<double> milliseconds(TIMED_FRAMES);
+    for (int i = 0; i < TIMED_FRAMES; i++) {
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &elapsed);
+        milliseconds[i] = elapsed * 1e-6;
+    }
+    glDeleteQueries(TIMED_FRAMES, queries);
+
+    std::nth_element(milliseconds.begin(), milliseconds.begin() + TIMED_FRAMES / 2, milliseconds.end());
+    return milliseconds[TIMED_FRAMES / 2];
+}
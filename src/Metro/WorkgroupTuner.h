@@ -0,0 +1,38 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+//
+// WorkgroupTuner – Remembers the fastest LOCAL_SIZE_X x LOCAL_SIZE_Y of compute.comp per GPU and
+// scene. The choice is stored in CACHE_FILE under a hash of the driver strings and a scene hash,
+// so the timing runs only the first time a scene is rendered on a device. Time() measures a
+// candidate with GL_TIME_ELAPSED queries; it waits for the results, which is fine at startup only.
+//
+class WorkgroupTuner {
+public:
+    struct Size {
+        int x;
+        int y;
+    };
+
+    explicit WorkgroupTuner(uint64_t sceneHash);
+
+    // Size stored for this GPU and scene, false if it hasn't been tuned yet
+    bool Load(Size& size) const;
+    void Save(Size size) const;
+
+    // Median GPU milliseconds of frame() over TIMED_FRAMES, after WARMUP_FRAMES untimed calls
+    static double Time(const std::function<void()>& frame);
+
+    // FNV-1a, stable across runs and compilers unlike std::hash
+    static uint64_t Hash(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+
+private:
+    static const char* CACHE_FILE;
+    static const int WARMUP_FRAMES = 2;
+    static const int TIMED_FRAMES = 5;
+
+    std::string key;
+};